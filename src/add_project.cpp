@@ -164,9 +164,9 @@ void AddProject::onAddFromURL()
 	auto username = getWidgetAs<UITextInput>("username")->getText();
 	auto password = getWidgetAs<UITextInput>("password")->getText();
 
-	parent.getWebClient().updateProjectData(url, project, username, password).then(aliveFlag, Executors::getMainUpdateThread(), [=](bool ok)
+	parent.getWebClient().updateProjectData(url, project, username, password).then(aliveFlag, Executors::getMainUpdateThread(), [=](WebClient::UpdateResult result)
 	{
-		if (ok) {
+		if (result != WebClient::UpdateResult::Failed) {
 			close();
 		} else {
 			showError("Unable to retrieve project data from web.");
@@ -0,0 +1,224 @@
+#include "binary_diff.h"
+
+namespace {
+	constexpr uint8_t opCopy = 1;
+	constexpr uint8_t opInsert = 2;
+
+	constexpr size_t headerSize = 12;
+	constexpr size_t copyArgumentsSize = 16;
+	constexpr size_t insertLengthSize = 8;
+
+	constexpr uint32_t hashMultiplier = 257;
+
+	uint64_t readLE64(const uint8_t* data)
+	{
+		uint64_t value = 0;
+		for (size_t i = 0; i < 8; ++i) {
+			value |= uint64_t(data[i]) << (8 * i);
+		}
+		return value;
+	}
+
+	void writeLE64(Bytes& dst, uint64_t value)
+	{
+		for (size_t i = 0; i < 8; ++i) {
+			dst.push_back(static_cast<gsl::byte>((value >> (8 * i)) & 0xFF));
+		}
+	}
+
+	uint32_t hashBlock(const gsl::byte* data, size_t size)
+	{
+		uint32_t hash = 0;
+		for (size_t i = 0; i < size; ++i) {
+			hash = hash * hashMultiplier + static_cast<uint8_t>(data[i]);
+		}
+		return hash;
+	}
+}
+
+Bytes BinaryDiff::make(gsl::span<const gsl::byte> base, gsl::span<const gsl::byte> target)
+{
+	Bytes result;
+	for (const char c: { 'H', 'D', 'I', 'F' }) {
+		result.push_back(static_cast<gsl::byte>(c));
+	}
+	writeLE64(result, target.size());
+
+	auto writeInsert = [&] (size_t start, size_t end)
+	{
+		if (end > start) {
+			result.push_back(static_cast<gsl::byte>(opInsert));
+			writeLE64(result, end - start);
+			result.insert(result.end(), target.begin() + start, target.begin() + end);
+		}
+	};
+	auto writeCopy = [&] (size_t offset, size_t length)
+	{
+		result.push_back(static_cast<gsl::byte>(opCopy));
+		writeLE64(result, offset);
+		writeLE64(result, length);
+	};
+
+	// Every aligned block of the base is indexed, and the target is scanned at every offset with a rolling hash,
+	// so unchanged data is found even where bytes were inserted or removed before it
+	HashMap<uint32_t, size_t> blocks;
+	for (size_t offset = 0; offset + blockSize <= base.size(); offset += blockSize) {
+		blocks.emplace(hashBlock(base.data() + offset, blockSize), offset);
+	}
+
+	// Weight of the byte leaving the window when the hash rolls forward
+	uint32_t outFactor = 1;
+	for (size_t i = 1; i < blockSize; ++i) {
+		outFactor *= hashMultiplier;
+	}
+
+	size_t literalStart = 0;
+	size_t pos = 0;
+	uint32_t hash = target.size() >= blockSize ? hashBlock(target.data(), blockSize) : 0;
+	while (!blocks.empty() && pos + blockSize <= target.size()) {
+		const auto iter = blocks.find(hash);
+		if (iter != blocks.end() && memcmp(base.data() + iter->second, target.data() + pos, blockSize) == 0) {
+			// Grow the match both ways; backwards only over bytes that haven't been written yet
+			size_t start = pos;
+			size_t baseStart = iter->second;
+			while (start > literalStart && baseStart > 0 && target[start - 1] == base[baseStart - 1]) {
+				--start;
+				--baseStart;
+			}
+			size_t end = pos + blockSize;
+			size_t baseEnd = iter->second + blockSize;
+			while (end < target.size() && baseEnd < base.size() && target[end] == base[baseEnd]) {
+				++end;
+				++baseEnd;
+			}
+
+			writeInsert(literalStart, start);
+			writeCopy(baseStart, end - start);
+			literalStart = end;
+			pos = end;
+			if (pos + blockSize <= target.size()) {
+				hash = hashBlock(target.data() + pos, blockSize);
+			}
+		} else {
+			if (pos + blockSize < target.size()) {
+				hash = (hash - static_cast<uint8_t>(target[pos]) * outFactor) * hashMultiplier + static_cast<uint8_t>(target[pos + blockSize]);
+			}
+			++pos;
+		}
+	}
+	writeInsert(literalStart, target.size());
+
+	return result;
+}
+
+BinaryDiff::BinaryDiff(gsl::span<const gsl::byte> base, OutputCallback output)
+	: base(base)
+	, output(std::move(output))
+{
+}
+
+bool BinaryDiff::feed(gsl::span<const gsl::byte> data)
+{
+	while (!data.empty() && state != State::Error) {
+		bool ok = true;
+		switch (state) {
+		case State::Header:
+			ok = !fillBuffer(data, headerSize) || onHeader();
+			break;
+		case State::Operation:
+			{
+				const auto op = static_cast<uint8_t>(data[0]);
+				data = data.subspan(1);
+				if (op == opCopy) {
+					state = State::CopyArguments;
+				} else if (op == opInsert) {
+					state = State::InsertLength;
+				} else {
+					ok = false;
+				}
+			}
+			break;
+		case State::CopyArguments:
+			ok = !fillBuffer(data, copyArgumentsSize) || onCopy();
+			break;
+		case State::InsertLength:
+			ok = !fillBuffer(data, insertLengthSize) || onInsertLength();
+			break;
+		case State::InsertData:
+			{
+				const auto n = static_cast<size_t>(std::min<uint64_t>(insertRemaining, data.size()));
+				ok = emit(data.subspan(0, n));
+				data = data.subspan(n);
+				insertRemaining -= n;
+				if (insertRemaining == 0) {
+					state = State::Operation;
+				}
+			}
+			break;
+		case State::Error:
+			break;
+		}
+
+		if (!ok) {
+			state = State::Error;
+		}
+	}
+
+	return state != State::Error;
+}
+
+bool BinaryDiff::finish() const
+{
+	// The size comes from the diff, so it's only trusted once the result is complete
+	return state == State::Operation && written == resultSize;
+}
+
+bool BinaryDiff::fillBuffer(gsl::span<const gsl::byte>& data, size_t size)
+{
+	const auto n = std::min(size - buffer.size(), data.size());
+	const auto* src = reinterpret_cast<const uint8_t*>(data.data());
+	buffer.insert(buffer.end(), src, src + n);
+	data = data.subspan(n);
+	return buffer.size() == size;
+}
+
+bool BinaryDiff::onHeader()
+{
+	if (memcmp(buffer.data(), "HDIF", 4) != 0) {
+		return false;
+	}
+	resultSize = readLE64(buffer.data() + 4);
+	buffer.clear();
+	state = State::Operation;
+	return resultSize <= maxResultSize;
+}
+
+bool BinaryDiff::onCopy()
+{
+	const auto offset = readLE64(buffer.data());
+	const auto length = readLE64(buffer.data() + 8);
+	buffer.clear();
+	state = State::Operation;
+
+	if (offset > base.size() || length > base.size() - offset || length > resultSize - written) {
+		return false;
+	}
+	return emit(base.subspan(static_cast<size_t>(offset), static_cast<size_t>(length)));
+}
+
+bool BinaryDiff::onInsertLength()
+{
+	insertRemaining = readLE64(buffer.data());
+	buffer.clear();
+	state = insertRemaining > 0 ? State::InsertData : State::Operation;
+	return insertRemaining <= resultSize - written;
+}
+
+bool BinaryDiff::emit(gsl::span<const gsl::byte> data)
+{
+	if (data.empty()) {
+		return true;
+	}
+	written += data.size();
+	return !output || output(data);
+}
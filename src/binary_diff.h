@@ -0,0 +1,55 @@
+#pragma once
+
+#include <halley.hpp>
+using namespace Halley;
+
+// Binary delta between two versions of a file, as used by editor patches.
+// Format: "HDIF", u64 result size, then a sequence of operations (integers are little-endian):
+//   1 (copy):   u64 offset, u64 length - copies a range of the base file
+//   2 (insert): u64 length, data       - inserts new bytes
+// make() writes it, and an instance applies it as a stream: the diff can be fed in arbitrarily sized pieces, and the result is
+// handed to the callback as it's produced, so only the base file has to be accessible in full (e.g. memory-mapped).
+class BinaryDiff {
+public:
+	// Return false to abort
+	using OutputCallback = std::function<bool(gsl::span<const gsl::byte>)>;
+
+	constexpr static uint64_t maxResultSize = 4ull * 1024 * 1024 * 1024;
+
+	// Finds blocks of target that already exist anywhere in base, and stores everything else as inserts
+	static Bytes make(gsl::span<const gsl::byte> base, gsl::span<const gsl::byte> target);
+
+	BinaryDiff(gsl::span<const gsl::byte> base, OutputCallback output);
+
+	// Returns false if the diff is malformed, doesn't fit the base, or the output callback aborted
+	bool feed(gsl::span<const gsl::byte> data);
+
+	// Returns true if the whole diff was received, and it produced exactly the size it declared
+	bool finish() const;
+
+private:
+	constexpr static size_t blockSize = 32;
+
+	enum class State {
+		Header,
+		Operation,
+		CopyArguments,
+		InsertLength,
+		InsertData,
+		Error
+	};
+
+	gsl::span<const gsl::byte> base;
+	OutputCallback output;
+	State state = State::Header;
+	Vector<uint8_t> buffer;
+	uint64_t resultSize = 0;
+	uint64_t written = 0;
+	uint64_t insertRemaining = 0;
+
+	bool fillBuffer(gsl::span<const gsl::byte>& data, size_t size);
+	bool onHeader();
+	bool onCopy();
+	bool onInsertLength();
+	bool emit(gsl::span<const gsl::byte> data);
+};
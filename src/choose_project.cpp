@@ -1,5 +1,7 @@
 #include "choose_project.h"
 
+#include <filesystem>
+
 #include "add_project.h"
 #include "launcher_stage.h"
 #include "launch_project.h"
@@ -11,12 +13,21 @@ ChooseProject::ChooseProject(UIFactory& factory, LauncherSettings& settings, ILa
 	, factory(factory)
 	, settings(settings)
 	, parent(parent)
+	, iconAtlas(factory.getResources(), *parent.getHalleyAPI().video)
 {
 	factory.loadUI(*this, "launcher/load_project");
 
+	// Rows are spaced by the height of a real entry until they've been laid out and can be measured
+	entryHeight = factory.makeUI("launcher/project_entry")->getLayoutMinimumSize(false).y;
+
 	loadPaths();
 }
 
+ChooseProject::~ChooseProject()
+{
+	scan->cancelled = true;
+}
+
 void ChooseProject::onMakeUI()
 {
 	const auto col = factory.getColourScheme()->getColour("logo");
@@ -41,7 +52,7 @@ void ChooseProject::onMakeUI()
 	
 	setHandle(UIEventType::ButtonClicked, "open", [=] (const UIEvent& event)
 	{
-		const auto id = getWidgetAs<UIList>("projects")->getSelectedOptionId();
+		const auto id = selectedProject;
 		Concurrent::execute(Executors::getMainUpdateThread(), [=]() {
 			onOpen(id);
 		});
@@ -49,7 +60,7 @@ void ChooseProject::onMakeUI()
 	
 	setHandle(UIEventType::ButtonClicked, "openSafe", [=] (const UIEvent& event)
 	{
-		const auto id = getWidgetAs<UIList>("projects")->getSelectedOptionId();
+		const auto id = selectedProject;
 		Concurrent::execute(Executors::getMainUpdateThread(), [=]() {
 			onOpen(id, true);
 		});
@@ -62,9 +73,18 @@ void ChooseProject::onMakeUI()
 		});
 	});
 
+	// The selected project can be scrolled out of the row pool, in which case no row is highlighted
+	getWidgetAs<UIList>("projects")->setRequiresSelection(false);
+
 	setHandle(UIEventType::ListSelectionChanged, "projects", [=](const UIEvent& event)
 	{
-		const auto id = event.getStringData();
+		// Rows are rebound as the list scrolls, so they're mapped to their project right away.
+		// Clearing or restoring the highlight in syncSelection doesn't change the selection.
+		const auto id = getRowProject(event.getStringData());
+		if (id.isEmpty() || id == selectedProject) {
+			return;
+		}
+		selectedProject = id;
 		Concurrent::execute(Executors::getMainUpdateThread(), [=]() {
 			onProjectSelected(id);
 		});
@@ -72,7 +92,7 @@ void ChooseProject::onMakeUI()
 
 	setHandle(UIEventType::ListAccept, "projects", [=] (const UIEvent& event)
 	{
-		const auto id = event.getStringData();
+		const auto id = getRowProject(event.getStringData());
 		Concurrent::execute(Executors::getMainUpdateThread(), [=]() {
 			onOpen(id);
 		});
@@ -83,6 +103,10 @@ void ChooseProject::onMakeUI()
 
 void ChooseProject::update(Time t, bool moved)
 {
+	rescanChangedProjects();
+	updateScan();
+	updateRows();
+
 	const auto newVersionInfo = parent.getNewVersionInfo();
 	getWidget("updateLauncher")->setActive(newVersionInfo && newVersionInfo->isNewVersion());
 }
@@ -103,13 +127,13 @@ void ChooseProject::onOpen(const String& path, bool safeMode)
 
 void ChooseProject::onProjectSelected(const String& path)
 {
+	// Read from what the scan already loaded, so moving through the list doesn't touch the disk
 	bool enabled = false;
 	bool safeEnabled = false;
-	if (const auto* project = settings.tryGetProject(path)) {
-		if (const auto properties = LauncherProjectProperties::getProjectProperties(*project, &factory.getResources(), parent.getHalleyAPI().video)) {
-			enabled = true;
-			safeEnabled = properties->halleyVersion >= HalleyVersion{ 3, 3, 79 };
-		}
+	const auto iter = projectProperties.find(path);
+	if (iter != projectProperties.end()) {
+		enabled = true;
+		safeEnabled = iter->second.halleyVersion >= HalleyVersion{ 3, 3, 79 };
 	}
 	getWidget("open")->setEnabled(enabled);
 	getWidget("openSafe")->setEnabled(safeEnabled);
@@ -122,43 +146,286 @@ void ChooseProject::onUpdateLauncher()
 
 void ChooseProject::loadPaths()
 {
-	Vector<Path> toRemove;
+	// Projects can be on slow or network drives, so they're read in parallel on worker threads. Unchanged projects come from the cache.
+	// Each one is listed straight away with a placeholder, which is filled in as soon as its properties arrive.
+	scan = std::make_shared<ProjectScan>();
 	for (const auto& projectLocation: settings.getProjects()) {
-		if (auto properties = LauncherProjectProperties::getProjectProperties(projectLocation, &factory.getResources(), parent.getHalleyAPI().video)) {
-			addPathToList(projectLocation, *properties);
+		addPathToList(projectLocation);
+		scanProject(projectLocation);
+	}
+}
+
+void ChooseProject::scanProject(const ProjectLocation& projectLocation)
+{
+	Concurrent::execute(Executors::getCPU(), [scan = scan, cache = parent.getProjectPropertiesCache(), projectLocation] ()
+	{
+		if (scan->cancelled) {
+			return;
+		}
+		auto properties = cache->get(projectLocation, true);
+		const bool missing = !properties && isProjectFolderGone(projectLocation.path);
+
+		std::unique_lock<std::mutex> lock(scan->mutex);
+		scan->results.push_back(ProjectScan::Result{ Path(projectLocation.path).getString(), std::move(properties), missing });
+	});
+}
+
+void ChooseProject::rescanChangedProjects()
+{
+	// Only the projects whose files changed are read again, and their entries updated in place when the results come in
+	for (const auto& path: watcher.getChangedProjects()) {
+		if (const auto* project = settings.tryGetProject(path)) {
+			scanProject(*project);
+		}
+	}
+}
+
+void ChooseProject::updateScan()
+{
+	Vector<ProjectScan::Result> results;
+	{
+		std::unique_lock<std::mutex> lock(scan->mutex);
+		results = std::move(scan->results);
+		scan->results.clear();
+	}
+
+	for (auto& result: results) {
+		if (result.properties) {
+			setProjectProperties(result.id, std::move(*result.properties));
+		} else if (result.missing) {
+			removeProject(result.id);
 		} else {
-			toRemove.push_back(projectLocation.path);
+			// Half-written, or on a drive that can't be reached right now; it's read again on the next change
+			setProjectUnavailable(result.id);
 		}
 	}
-	for (const auto& path: toRemove) {
-		settings.removeProject(path);
+
+	// Icons which arrived this frame are uploaded together
+	if (iconAtlas.flush()) {
+		updateIcons();
 	}
 }
 
-void ChooseProject::addPathToList(const ProjectLocation& projectLocation, const LauncherProjectProperties& properties)
+void ChooseProject::addPathToList(const ProjectLocation& projectLocation)
 {
-	const auto list = getWidgetAs<UIList>("projects");
+	const auto path = Path(projectLocation.path);
+	const auto id = path.getString();
 
-	const auto id = properties.path.getString();
+	ListEntry entry;
+	entry.name = path.getFilename().getString();
+	entry.pathToShow = projectLocation.params["url"].asString(path.getNativeString(false));
 
-	auto pathToShow = projectLocation.params["url"].asString(properties.path.getNativeString(false));
+	listOrder.push_back(id);
+	watcher.addProject(path);
+	listEntries[id] = std::move(entry);
+}
 
-	auto entry = factory.makeUI("launcher/project_entry");
-	entry->getWidgetAs<UILabel>("project_name")->setText(LocalisedString::fromUserString(properties.name));
-	entry->getWidgetAs<UILabel>("project_path")->setText(LocalisedString::fromUserString(pathToShow));
-	entry->getWidgetAs<UILabel>("halley_version")->setText(LocalisedString::fromUserString("Halley v" + properties.halleyVersion.toString()));
+void ChooseProject::removeProject(const String& id)
+{
+	settings.removeProject(id);
+	watcher.removeProject(id);
 
-	if (properties.icon.hasMaterial()) {
-		entry->getWidgetAs<UIImage>("project_icon")->setSprite(properties.icon);
+	// The rows below it are rebound on the next update
+	listEntries.erase(id);
+	listOrder.erase(std::remove(listOrder.begin(), listOrder.end(), id), listOrder.end());
+	std::replace(rowProjects.begin(), rowProjects.end(), id, String());
+	projectProperties.erase(id);
+	iconAtlas.remove(id);
+	if (selectedProject == id) {
+		selectedProject = {};
 	}
+}
 
-	entry->setHandle(UIEventType::ButtonClicked, "delete", [=] (const UIEvent& event)
-	{
-		Concurrent::execute(Executors::getMainUpdateThread(), [=]() {
-			settings.removeProject(id);
-			list->removeItem(id);
+void ChooseProject::setProjectProperties(const String& id, LauncherProjectProperties properties)
+{
+	const auto iter = listEntries.find(id);
+	if (iter == listEntries.end()) {
+		return;
+	}
+	auto& entry = iter->second;
+	entry.name = properties.name;
+	entry.version = "Halley v" + properties.halleyVersion.toString();
+	if (properties.builtVersion != properties.halleyVersion) {
+		const auto* project = settings.tryGetProject(id);
+		entry.version += project && project->params.hasKey("url") ? " (needs update)" : " (needs build)";
+	}
+
+	// Icons go in the shared atlas, and are set on the entry once it's uploaded; only ones which don't fit get their own texture
+	if (!properties.iconImage || !iconAtlas.add(id, *properties.iconImage)) {
+		properties.makeIcon(factory.getResources(), *parent.getHalleyAPI().video);
+	}
+
+	projectProperties[id] = std::move(properties);
+	refreshRow(id);
+	if (selectedProject == id) {
+		onProjectSelected(id);
+	}
+}
+
+void ChooseProject::setProjectUnavailable(const String& id)
+{
+	const auto iter = listEntries.find(id);
+	if (iter == listEntries.end()) {
+		return;
+	}
+	auto& entry = iter->second;
+	entry.version = "(unavailable)";
+
+	projectProperties.erase(id);
+	iconAtlas.remove(id);
+	refreshRow(id);
+	if (selectedProject == id) {
+		onProjectSelected(id);
+	}
+}
+
+bool ChooseProject::isProjectFolderGone(const Path& path)
+{
+	// Only trust a "not found" if the folder above it can be seen, otherwise the whole drive may just be unreachable
+	std::error_code ec;
+	const auto status = std::filesystem::status(path.getString().cppStr(), ec);
+	if (status.type() != std::filesystem::file_type::not_found) {
+		return false;
+	}
+	return std::filesystem::is_directory(path.parentPath().getString().cppStr(), ec);
+}
+
+void ChooseProject::updateIcons()
+{
+	for (size_t i = 0; i < rows.size(); ++i) {
+		if (!rowProjects[i].isEmpty()) {
+			if (auto sprite = iconAtlas.getSprite(rowProjects[i])) {
+				rows[i]->getWidgetAs<UIImage>("project_icon")->setSprite(std::move(*sprite));
+			}
+		}
+	}
+}
+
+void ChooseProject::updateRows()
+{
+	// Enough rows to cover the pane wherever it's scrolled to, plus some overscan either side for keyboard navigation
+	const auto step = getRowStep();
+	const auto paneRect = getWidget("projectsPane")->getRect();
+	const auto numInView = static_cast<size_t>(std::ceil(paneRect.getHeight() / step)) + 1;
+	resizeRows(std::min(listOrder.size(), numInView + 2 * overscan));
+
+	// The top spacer starts where the pane's contents do, so its distance above the pane is how far the pane is scrolled
+	const auto top = getWidget("projectsTop");
+	const auto scrolled = std::max(0.0f, paneRect.getTop() - top->getRect().getTop());
+	const auto firstInView = static_cast<size_t>(scrolled / step);
+	firstRow = std::min(firstInView > overscan ? firstInView - overscan : 0, listOrder.size() - rows.size());
+
+	top->setMinSize(Vector2f(0, static_cast<float>(firstRow) * step));
+	getWidget("projectsBottom")->setMinSize(Vector2f(0, static_cast<float>(listOrder.size() - firstRow - rows.size()) * step));
+
+	for (size_t i = 0; i < rows.size(); ++i) {
+		if (rowProjects[i] != listOrder[firstRow + i]) {
+			bindRow(i, listOrder[firstRow + i]);
+		}
+	}
+
+	syncSelection();
+}
+
+void ChooseProject::resizeRows(size_t count)
+{
+	// Only happens when the pane is resized, or there are fewer projects than rows
+	const auto list = getWidgetAs<UIList>("projects");
+	while (rows.size() > count) {
+		list->removeItem(getRowId(rows.size() - 1));
+		rows.pop_back();
+		rowProjects.pop_back();
+	}
+
+	while (rows.size() < count) {
+		const auto row = rows.size();
+		auto widget = factory.makeUI("launcher/project_entry");
+		widget->setHandle(UIEventType::ButtonClicked, "delete", [=] (const UIEvent& event)
+		{
+			const auto id = row < rowProjects.size() ? rowProjects[row] : String();
+			if (!id.isEmpty()) {
+				Concurrent::execute(Executors::getMainUpdateThread(), [=]() {
+					removeProject(id);
+				});
+			}
 		});
-	});
 
-	list->addItem(id, std::move(entry), 1);
+		list->addItem(getRowId(row), widget, 1);
+		rows.push_back(std::move(widget));
+		rowProjects.push_back({});
+	}
+}
+
+void ChooseProject::bindRow(size_t row, const String& id)
+{
+	rowProjects[row] = id;
+	const auto& entry = listEntries[id];
+	const auto& widget = rows[row];
+
+	widget->getWidgetAs<UILabel>("project_name")->setText(LocalisedString::fromUserString(entry.name));
+	widget->getWidgetAs<UILabel>("project_path")->setText(LocalisedString::fromUserString(entry.pathToShow));
+	if (entry.version.isEmpty()) {
+		widget->getWidgetAs<UILabel>("halley_version")->setText(LocalisedString::fromHardcodedString("Loading..."));
+	} else {
+		widget->getWidgetAs<UILabel>("halley_version")->setText(LocalisedString::fromUserString(entry.version));
+	}
+
+	Sprite icon;
+	if (auto atlasIcon = iconAtlas.getSprite(id)) {
+		icon = std::move(*atlasIcon);
+	} else if (const auto iter = projectProperties.find(id); iter != projectProperties.end()) {
+		icon = iter->second.icon;
+	}
+	widget->getWidgetAs<UIImage>("project_icon")->setSprite(std::move(icon));
+}
+
+void ChooseProject::refreshRow(const String& id)
+{
+	const auto iter = std::find(rowProjects.begin(), rowProjects.end(), id);
+	if (iter != rowProjects.end()) {
+		bindRow(static_cast<size_t>(iter - rowProjects.begin()), id);
+	}
+}
+
+void ChooseProject::syncSelection()
+{
+	// The highlighted row follows the selected project while it's in the pool. Once it's scrolled further away than that,
+	// no row is highlighted, but the project stays selected until the user picks another one.
+	const auto list = getWidgetAs<UIList>("projects");
+	const auto iter = std::find(rowProjects.begin(), rowProjects.end(), selectedProject);
+	if (!selectedProject.isEmpty() && iter != rowProjects.end()) {
+		const auto rowId = getRowId(static_cast<size_t>(iter - rowProjects.begin()));
+		if (list->getSelectedOptionId() != rowId) {
+			list->setSelectedOptionId(rowId);
+		}
+	} else if (list->getSelectedOption() != -1) {
+		list->setSelectedOption(-1);
+	}
+}
+
+float ChooseProject::getRowStep() const
+{
+	// Measured once the rows are laid out, so it includes the list's gap
+	if (rows.size() >= 2) {
+		const auto step = rows[1]->getPosition().y - rows[0]->getPosition().y;
+		if (step > 0) {
+			return step;
+		}
+	}
+	return std::max(entryHeight, 1.0f);
+}
+
+String ChooseProject::getRowProject(const String& rowId) const
+{
+	for (size_t i = 0; i < rows.size(); ++i) {
+		if (getRowId(i) == rowId) {
+			return rowProjects[i];
+		}
+	}
+	return {};
+}
+
+String ChooseProject::getRowId(size_t row)
+{
+	return "row_" + toString(row);
 }
@@ -2,6 +2,8 @@
 
 #include <halley.hpp>
 #include "launcher_project_properties.h"
+#include "project_icon_atlas.h"
+#include "project_watcher.h"
 
 class LauncherSettings;
 
@@ -11,14 +13,51 @@ namespace Halley {
 	class ChooseProject : public UIWidget {
     public:
     	ChooseProject(UIFactory& factory, LauncherSettings& settings, ILauncher& parent);
+        ~ChooseProject() override;
 
         void onMakeUI() override;
         void update(Time t, bool moved) override;
     	
     private:
+        // Filled by worker threads as projects are read from disk, and drained on the main thread
+        struct ProjectScan {
+            struct Result {
+                String id;
+                std::optional<LauncherProjectProperties> properties;
+                bool missing = false; // Only set if the project's folder is confirmed to be gone
+            };
+
+            std::mutex mutex;
+            Vector<Result> results;
+            std::atomic<bool> cancelled = false;
+        };
+
     	UIFactory& factory;
         LauncherSettings& settings;
         ILauncher& parent;
+
+        // The list only holds a fixed pool of rows, enough to cover the pane plus a few rows of overscan. Spacers above and below
+        // the list give the pane the height of the whole project list, and as it scrolls the rows are rebound to the projects in view.
+        struct ListEntry {
+            String name;
+            String pathToShow;
+            String version; // Empty until the project's properties arrive
+        };
+
+        constexpr static size_t overscan = 2;
+
+        ProjectIconAtlas iconAtlas;
+        ProjectWatcher watcher;
+        std::shared_ptr<ProjectScan> scan;
+        HashMap<String, LauncherProjectProperties> projectProperties;
+
+        HashMap<String, ListEntry> listEntries;
+        Vector<String> listOrder;
+        Vector<std::shared_ptr<UIWidget>> rows;
+        Vector<String> rowProjects; // Project shown by each row, empty if the row hasn't been bound yet
+        size_t firstRow = 0; // Index in listOrder of the project shown by the first row
+        float entryHeight = 0;
+        String selectedProject;
         
         void onAdd();
         void onOpen(const String& path, bool safeMode = false);
@@ -26,6 +65,24 @@ namespace Halley {
         void onUpdateLauncher();
 
     	void loadPaths();
-        void addPathToList(const ProjectLocation& projectLocation, const LauncherProjectProperties& properties);
+        void scanProject(const ProjectLocation& projectLocation);
+        void updateScan();
+        void rescanChangedProjects();
+        void addPathToList(const ProjectLocation& projectLocation);
+        void removeProject(const String& id);
+        void setProjectProperties(const String& id, LauncherProjectProperties properties);
+        void setProjectUnavailable(const String& id);
+        void updateIcons();
+
+        void updateRows();
+        void resizeRows(size_t count);
+        void bindRow(size_t row, const String& id);
+        void refreshRow(const String& id);
+        void syncSelection();
+        float getRowStep() const;
+        String getRowProject(const String& rowId) const;
+        static String getRowId(size_t row);
+
+        static bool isProjectFolderGone(const Path& path);
     };
 }
@@ -0,0 +1,21 @@
+#include "crc32.h"
+
+#define MINIZ_NO_ZLIB_COMPATIBLE_NAMES
+#include <miniz.h>
+
+void CRC32::feed(gsl::span<const gsl::byte> data)
+{
+	value = static_cast<uint32_t>(mz_crc32(value, reinterpret_cast<const unsigned char*>(data.data()), data.size()));
+}
+
+uint32_t CRC32::get() const
+{
+	return value;
+}
+
+uint32_t CRC32::compute(gsl::span<const gsl::byte> data)
+{
+	CRC32 crc;
+	crc.feed(data);
+	return crc.get();
+}
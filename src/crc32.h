@@ -0,0 +1,16 @@
+#pragma once
+
+#include <halley.hpp>
+using namespace Halley;
+
+// Incremental CRC-32 (IEEE 802.3), as used by gzip and zip, computed by the engine's miniz
+class CRC32 {
+public:
+	void feed(gsl::span<const gsl::byte> data);
+	uint32_t get() const;
+
+	static uint32_t compute(gsl::span<const gsl::byte> data);
+
+private:
+	uint32_t value = 0;
+};
@@ -0,0 +1,221 @@
+#include "editor_patch.h"
+
+#include <filesystem>
+
+#include "binary_diff.h"
+#include "file_writer.h"
+#include "mapped_file.h"
+#include "sha256.h"
+
+EditorPatch::EditorPatch(Path projectPath)
+	: projectPath(std::move(projectPath))
+{
+}
+
+bool EditorPatch::load(const Path& patchPath)
+{
+	if (!zip.open(patchPath)) {
+		return false;
+	}
+
+	const auto& zipFiles = zip.getEntries();
+	for (size_t i = 0; i < zipFiles.size(); ++i) {
+		zipEntries[zipFiles[i].name] = i;
+	}
+
+	const auto manifestBytes = extract("patch.yaml");
+	if (manifestBytes.empty()) {
+		return false;
+	}
+
+	const auto manifest = YAMLConvert::parseConfig(manifestBytes);
+	for (const auto& fileNode: manifest.getRoot()["files"].asSequence()) {
+		Entry entry;
+		entry.path = fileNode["path"].asString("");
+		entry.sha256 = fileNode["sha256"].asString("");
+
+		const auto op = fileNode["op"].asString("");
+		if (op == "add") {
+			entry.operation = Operation::Add;
+		} else if (op == "diff") {
+			entry.operation = Operation::Diff;
+		} else if (op == "delete") {
+			entry.operation = Operation::Delete;
+		} else {
+			Logger::logError("Unknown patch operation \"" + op + "\" for " + entry.path);
+			return false;
+		}
+
+		if (!ZipReader::isSafeName(entry.path)) {
+			return false;
+		}
+		entries.push_back(std::move(entry));
+	}
+
+	return !entries.empty();
+}
+
+bool EditorPatch::apply()
+{
+	// Write everything next to its destination first, so a failure there leaves the install untouched
+	Vector<std::pair<Path, Path>> toMove;
+	Vector<Path> toDelete;
+	bool ok = true;
+
+	for (const auto& entry: entries) {
+		const auto path = projectPath / entry.path;
+		if (entry.operation == Operation::Delete) {
+			toDelete.push_back(path);
+			continue;
+		}
+
+		const auto tmpPath = Path(path.getString() + ".patched");
+		std::error_code ec;
+		std::filesystem::create_directories(path.parentPath().getString().cppStr(), ec);
+		if (!writeFile(entry, tmpPath)) {
+			Logger::logError("Unable to patch " + entry.path);
+			std::filesystem::remove(tmpPath.getString().cppStr(), ec);
+			ok = false;
+			break;
+		}
+		toMove.emplace_back(tmpPath, path);
+	}
+
+	// Then swap the files in, moving the originals aside so they can be put back if any of them can't be replaced
+	Vector<Replaced> replaced;
+	if (ok) {
+		for (const auto& [tmpPath, path]: toMove) {
+			if (!replaceFile(path, tmpPath, replaced)) {
+				ok = false;
+				break;
+			}
+		}
+	}
+	if (ok) {
+		for (const auto& path: toDelete) {
+			if (!replaceFile(path, std::nullopt, replaced)) {
+				ok = false;
+				break;
+			}
+		}
+	}
+
+	std::error_code ec;
+	if (!ok) {
+		rollback(replaced);
+		for (const auto& [tmpPath, path]: toMove) {
+			std::filesystem::remove(tmpPath.getString().cppStr(), ec);
+		}
+		return false;
+	}
+
+	for (const auto& file: replaced) {
+		if (file.backupPath) {
+			std::filesystem::remove(file.backupPath->getString().cppStr(), ec);
+		}
+	}
+	return true;
+}
+
+bool EditorPatch::replaceFile(const Path& path, const std::optional<Path>& newPath, Vector<Replaced>& replaced)
+{
+	std::error_code ec;
+	Replaced file;
+	file.path = path;
+	if (std::filesystem::exists(path.getString().cppStr(), ec)) {
+		file.backupPath = Path(path.getString() + ".orig");
+		std::filesystem::rename(path.getString().cppStr(), file.backupPath->getString().cppStr(), ec);
+		if (ec) {
+			Logger::logError("Unable to replace " + path.getNativeString(false));
+			return false;
+		}
+	}
+	file.replaced = !!newPath;
+	replaced.push_back(file);
+
+	if (newPath) {
+		std::filesystem::rename(newPath->getString().cppStr(), path.getString().cppStr(), ec);
+		if (ec) {
+			Logger::logError("Unable to replace " + path.getNativeString(false));
+			return false;
+		}
+	}
+	return true;
+}
+
+void EditorPatch::rollback(const Vector<Replaced>& replaced)
+{
+	std::error_code ec;
+	for (auto iter = replaced.rbegin(); iter != replaced.rend(); ++iter) {
+		const auto path = iter->path.getString().cppStr();
+		if (iter->backupPath) {
+			std::filesystem::rename(iter->backupPath->getString().cppStr(), path, ec);
+			if (ec) {
+				Logger::logError("Unable to restore " + iter->path.getNativeString(false) + " after a failed update.");
+			}
+		} else if (iter->replaced) {
+			std::filesystem::remove(path, ec);
+		}
+	}
+}
+
+bool EditorPatch::writeFile(const Entry& entry, const Path& dstPath)
+{
+	FileWriter writer;
+	SHA256Hasher hasher;
+	auto output = [&] (gsl::span<const gsl::byte> data) -> bool
+	{
+		hasher.feed(data);
+		return writer.write(data);
+	};
+
+	bool ok = false;
+	if (entry.operation == Operation::Add) {
+		ok = writer.open(dstPath) && extract("files/" + entry.path, output);
+	} else if (entry.operation == Operation::Diff) {
+		// Checked separately, as an empty base file is valid but can't be mapped
+		const auto basePath = projectPath / entry.path;
+		std::error_code ec;
+		if (!std::filesystem::is_regular_file(basePath.getString().cppStr(), ec)) {
+			return false;
+		}
+		MappedFile base;
+		if (std::filesystem::file_size(basePath.getString().cppStr(), ec) != 0 && !base.open(basePath)) {
+			return false;
+		}
+
+		BinaryDiff diff(base.getSpan(), output);
+		ok = writer.open(dstPath) && extract("diffs/" + entry.path, [&] (gsl::span<const gsl::byte> data) -> bool
+		{
+			return diff.feed(data);
+		}) && diff.finish();
+	}
+
+	if (!writer.close() || !ok) {
+		return false;
+	}
+
+	if (!entry.sha256.isEmpty() && SHA256Hasher::toHex(hasher.digest().byte_span()) != entry.sha256) {
+		Logger::logError("Checksum mismatch after patching " + entry.path);
+		return false;
+	}
+	return true;
+}
+
+bool EditorPatch::extract(const String& name, const ZipReader::OutputCallback& output)
+{
+	const auto iter = zipEntries.find(name);
+	if (iter == zipEntries.end()) {
+		return false;
+	}
+	return zip.extract(zip.getEntries()[iter->second], output);
+}
+
+Bytes EditorPatch::extract(const String& name)
+{
+	const auto iter = zipEntries.find(name);
+	if (iter == zipEntries.end()) {
+		return {};
+	}
+	return zip.extractBytes(zip.getEntries()[iter->second]).value_or(Bytes());
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <halley.hpp>
+
+#include "zip_reader.h"
+using namespace Halley;
+
+// A binary patch between two editor versions, published next to the full editor zip.
+// The patch is a zip containing patch.yaml, which lists each changed file, plus the data for it:
+//   add:    files/<path> holds the new contents
+//   diff:   diffs/<path> holds a delta against the installed file (see BinaryDiff)
+//   delete: the file is removed
+// Each new file is streamed from the patch to disk, so only the installed file it's based on is accessed in full, and that's
+// memory-mapped rather than loaded.
+class EditorPatch {
+public:
+	EditorPatch(Path projectPath);
+
+	// The patch is read from disk as it's applied, so the file must stay in place until this is destroyed
+	bool load(const Path& patchPath);
+	bool apply();
+
+private:
+	enum class Operation {
+		Add,
+		Diff,
+		Delete
+	};
+
+	struct Entry {
+		String path;
+		Operation operation;
+		String sha256;
+	};
+
+	struct Replaced {
+		Path path;
+		std::optional<Path> backupPath; // Where the original was moved, if there was one
+		bool replaced = false; // False if the file was only deleted
+	};
+
+	Path projectPath;
+	ZipReader zip;
+	HashMap<String, size_t> zipEntries;
+	Vector<Entry> entries;
+
+	bool writeFile(const Entry& entry, const Path& dstPath);
+	bool extract(const String& name, const ZipReader::OutputCallback& output);
+	Bytes extract(const String& name);
+
+	static bool replaceFile(const Path& path, const std::optional<Path>& newPath, Vector<Replaced>& replaced);
+	static void rollback(const Vector<Replaced>& replaced);
+};
@@ -0,0 +1,207 @@
+#include "editor_store.h"
+
+#include <ctime>
+#include <filesystem>
+#include <set>
+
+#include "file_lock.h"
+#include "sha256.h"
+
+EditorStore::EditorStore(Path rootPath, uint64_t maxSize)
+	: rootPath(std::move(rootPath))
+	, maxSize(maxSize)
+{
+}
+
+std::optional<Path> EditorStore::getArchive(HalleyVersion version)
+{
+	auto lock = std::unique_lock(mutex);
+	FileLock fileLock(getLockPath());
+	loadIndex();
+
+	const auto key = version.toString();
+	if (!index.hasKey(key)) {
+		return std::nullopt;
+	}
+
+	auto& entry = index[key];
+	const auto path = getArchivePath(entry["hash"].asString(""));
+	std::error_code ec;
+	const auto size = std::filesystem::file_size(path.getString().cppStr(), ec);
+	if (ec || size != static_cast<uint64_t>(entry["size"].asInt64(0))) {
+		index.removeKey(key);
+		saveIndex();
+		return std::nullopt;
+	}
+
+	entry["lastUsed"] = static_cast<int64_t>(std::time(nullptr));
+	saveIndex();
+
+	return path;
+}
+
+std::optional<Path> EditorStore::addArchive(HalleyVersion version, const Path& archivePath, std::optional<Bytes> sha256)
+{
+	const auto digest = sha256 ? std::move(sha256) : SHA256Hasher::hashFile(archivePath);
+	if (!digest) {
+		return std::nullopt;
+	}
+	const auto hash = SHA256Hasher::toHex(digest->byte_span());
+
+	std::error_code ec;
+	const auto size = std::filesystem::file_size(archivePath.getString().cppStr(), ec);
+	if (ec) {
+		return std::nullopt;
+	}
+
+	auto lock = std::unique_lock(mutex);
+	FileLock fileLock(getLockPath());
+	loadIndex();
+
+	const auto path = getArchivePath(hash);
+	std::filesystem::create_directories(rootPath.getString().cppStr(), ec);
+	if (std::filesystem::exists(path.getString().cppStr(), ec)) {
+		std::filesystem::remove(archivePath.getString().cppStr(), ec);
+	} else {
+		std::filesystem::rename(archivePath.getString().cppStr(), path.getString().cppStr(), ec);
+		if (ec) {
+			Logger::logError("Unable to move " + archivePath.getNativeString(false) + " into editor store.");
+			return std::nullopt;
+		}
+	}
+
+	ConfigNode::MapType entry;
+	entry["hash"] = hash;
+	entry["size"] = static_cast<int64_t>(size);
+	entry["lastUsed"] = static_cast<int64_t>(std::time(nullptr));
+	index[version.toString()] = std::move(entry);
+	saveIndex();
+
+	return path;
+}
+
+void EditorStore::collectGarbage(const std::optional<Vector<HalleyVersion>>& versionsInUse, int64_t usedSince)
+{
+	if (!versionsInUse) {
+		return;
+	}
+
+	auto lock = std::unique_lock(mutex);
+	FileLock fileLock(getLockPath());
+	if (!fileLock.isLocked()) {
+		return;
+	}
+	loadIndex();
+
+	std::set<String> keep;
+	for (const auto& version: *versionsInUse) {
+		keep.insert(version.toString());
+	}
+	for (const auto& [key, entry]: index.asMap()) {
+		if (entry["lastUsed"].asInt64(0) >= usedSince) {
+			keep.insert(key);
+		}
+	}
+
+	Vector<String> toRemove;
+	for (const auto& [key, entry]: index.asMap()) {
+		if (keep.find(key) == keep.end()) {
+			toRemove.push_back(key);
+		}
+	}
+	for (const auto& key: toRemove) {
+		Logger::logInfo("Removing editor " + key + " from store, as no project uses it.");
+		index.removeKey(key);
+	}
+
+	trimToSize(keep);
+	saveIndex();
+	removeUnusedFiles();
+}
+
+void EditorStore::trimToSize(const std::set<String>& keep)
+{
+	// Several versions can share an archive, so sizes are counted per file
+	HashMap<String, uint64_t> sizes;
+	for (const auto& [key, entry]: index.asMap()) {
+		sizes[entry["hash"].asString("")] = static_cast<uint64_t>(entry["size"].asInt64(0));
+	}
+	uint64_t totalSize = 0;
+	for (const auto& [hash, size]: sizes) {
+		totalSize += size;
+	}
+
+	while (totalSize > maxSize) {
+		std::optional<String> oldestKey;
+		int64_t oldestTime = 0;
+		for (const auto& [key, entry]: index.asMap()) {
+			const auto lastUsed = entry["lastUsed"].asInt64(0);
+			if (keep.find(key) == keep.end() && (!oldestKey || lastUsed < oldestTime)) {
+				oldestKey = key;
+				oldestTime = lastUsed;
+			}
+		}
+		if (!oldestKey) {
+			break;
+		}
+
+		const auto hash = index[*oldestKey]["hash"].asString("");
+		Logger::logInfo("Removing editor " + *oldestKey + " from store, to keep it under its size limit.");
+		index.removeKey(*oldestKey);
+
+		bool shared = false;
+		for (const auto& [key, entry]: index.asMap()) {
+			shared = shared || entry["hash"].asString("") == hash;
+		}
+		if (!shared) {
+			totalSize -= sizes[hash];
+		}
+	}
+}
+
+void EditorStore::removeUnusedFiles()
+{
+	// Only called with the lock held, so archives added by other launchers are already in the index
+	std::set<String> used;
+	for (const auto& [key, entry]: index.asMap()) {
+		used.insert(getArchivePath(entry["hash"].asString("")).getFilename().getString());
+	}
+
+	std::error_code ec;
+	for (const auto& file: std::filesystem::directory_iterator(rootPath.getString().cppStr(), ec)) {
+		const auto name = String(file.path().filename().string());
+		if (name.endsWith(".zip") && used.find(name) == used.end()) {
+			std::filesystem::remove(file.path(), ec);
+		}
+	}
+}
+
+void EditorStore::loadIndex()
+{
+	// Another launcher may have changed it since we last looked
+	index = ConfigNode();
+	const auto bytes = Path::readFile(rootPath / "index");
+	if (!bytes.empty()) {
+		index = ConfigNode(Deserializer::fromBytes<ConfigFile>(bytes).getRoot());
+	}
+	if (index.getType() != ConfigNodeType::Map) {
+		index = ConfigNode::MapType();
+	}
+}
+
+void EditorStore::saveIndex() const
+{
+	ConfigFile file;
+	file.getRoot() = ConfigNode(index);
+	Path::writeFile(rootPath / "index", Serializer::toBytes(file));
+}
+
+Path EditorStore::getArchivePath(const String& hash) const
+{
+	return rootPath / (hash + ".zip");
+}
+
+Path EditorStore::getLockPath() const
+{
+	return rootPath / "index.lock";
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <halley.hpp>
+
+#include <set>
+using namespace Halley;
+
+// Launcher-wide store of downloaded editor archives, shared by all projects and by every running launcher.
+// Archives are stored by content hash, and indexed by the Halley version they provide.
+// The index is only read and written while holding a lock file, and is read again every time, so launchers don't undo each other's changes.
+// Editors are only removed by collectGarbage, which never drops a version that a project uses or that was used while it was looking.
+class EditorStore {
+public:
+	constexpr static uint64_t defaultMaxSize = 4ull * 1024 * 1024 * 1024;
+
+	EditorStore(Path rootPath, uint64_t maxSize = defaultMaxSize);
+
+	std::optional<Path> getArchive(HalleyVersion version);
+	std::optional<Path> addArchive(HalleyVersion version, const Path& archivePath, std::optional<Bytes> sha256 = std::nullopt);
+
+	// Removes every version not in versionsInUse, then trims the store to its size limit by dropping the least recently used ones.
+	// Versions used at or after usedSince are kept either way, as they may belong to a project that versionsInUse doesn't know about yet.
+	// If versionsInUse isn't known, nothing is removed.
+	void collectGarbage(const std::optional<Vector<HalleyVersion>>& versionsInUse, int64_t usedSince);
+
+private:
+	Path rootPath;
+	uint64_t maxSize;
+	std::mutex mutex;
+	ConfigNode index;
+
+	void loadIndex();
+	void saveIndex() const;
+	void trimToSize(const std::set<String>& keep);
+	void removeUnusedFiles();
+	Path getArchivePath(const String& hash) const;
+	Path getLockPath() const;
+};
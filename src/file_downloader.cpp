@@ -0,0 +1,582 @@
+#include "file_downloader.h"
+
+#include <filesystem>
+
+uint64_t FileDownloader::Segment::getPosition() const
+{
+	return start + written;
+}
+
+bool FileDownloader::Segment::isComplete() const
+{
+	return getPosition() >= end;
+}
+
+FileDownloader::FileDownloader(WebAPI& webAPI, String url, Path destination, uint64_t chunkSize)
+	: webAPI(webAPI)
+	, url(url)
+	, resolvedUrl(std::move(url))
+	, destination(std::move(destination))
+	, partialPath(this->destination.getString() + ".part")
+	, partialInfoPath(this->destination.getString() + ".part.info")
+	, chunkSize(chunkSize)
+{
+}
+
+void FileDownloader::setProgressCallback(ProgressCallback callback)
+{
+	progressCallback = std::move(callback);
+}
+
+void FileDownloader::setStreamCallback(StreamCallback callback)
+{
+	streamCallback = std::move(callback);
+}
+
+void FileDownloader::setMaxConnections(int connections)
+{
+	maxConnections = std::max(connections, 1);
+}
+
+void FileDownloader::setHeader(String name, String value)
+{
+	headers.emplace_back(std::move(name), std::move(value));
+}
+
+void FileDownloader::setResumable(bool value)
+{
+	resumable = value;
+}
+
+Future<bool> FileDownloader::start()
+{
+	auto result = promise.getFuture();
+
+	std::error_code ec;
+	std::filesystem::create_directories(destination.parentPath().getString().cppStr(), ec);
+
+	if (resumable) {
+		loadPartial();
+	} else {
+		discardPartial();
+	}
+	probeRanges();
+
+	return result;
+}
+
+const Path& FileDownloader::getDestination() const
+{
+	return destination;
+}
+
+int FileDownloader::getLastResponseCode() const
+{
+	return lastResponseCode;
+}
+
+void FileDownloader::loadPartial()
+{
+	const auto infoBytes = Path::readFile(partialInfoPath);
+	if (infoBytes.empty()) {
+		return;
+	}
+
+	const auto info = Deserializer::fromBytes<ConfigFile>(infoBytes);
+	const auto& root = info.getRoot();
+	totalSize = static_cast<uint64_t>(root["totalSize"].asInt64(0));
+
+	std::error_code ec;
+	const auto partialSize = std::filesystem::file_size(partialPath.getString().cppStr(), ec);
+	if (root["url"].asString("") != url || ec || totalSize == 0 || partialSize != totalSize) {
+		discardPartial();
+		return;
+	}
+
+	for (const auto& segmentNode: root["segments"].asSequence()) {
+		segments.push_back(std::make_unique<Segment>());
+		auto& segment = *segments.back();
+		segment.start = static_cast<uint64_t>(segmentNode["start"].asInt64(0));
+		segment.end = static_cast<uint64_t>(segmentNode["end"].asInt64(0));
+		segment.written = static_cast<uint64_t>(segmentNode["written"].asInt64(0));
+		if (segment.end > totalSize || segment.getPosition() > segment.end) {
+			discardPartial();
+			return;
+		}
+	}
+}
+
+void FileDownloader::savePartialInfo()
+{
+	auto lock = std::unique_lock(mutex);
+
+	ConfigNode::SequenceType segmentNodes;
+	for (const auto& segment: segments) {
+		ConfigNode::MapType segmentNode;
+		segmentNode["start"] = static_cast<int64_t>(segment->start);
+		segmentNode["end"] = static_cast<int64_t>(segment->end);
+		segmentNode["written"] = static_cast<int64_t>(segment->written);
+		segmentNodes.push_back(std::move(segmentNode));
+	}
+
+	ConfigFile info;
+	auto& root = info.getRoot();
+	root = ConfigNode::MapType();
+	root["url"] = url;
+	root["resolvedUrl"] = resolvedUrl;
+	root["totalSize"] = static_cast<int64_t>(totalSize);
+	root["segments"] = std::move(segmentNodes);
+	Path::writeFile(partialInfoPath, Serializer::toBytes(info));
+}
+
+void FileDownloader::discardPartial()
+{
+	std::error_code ec;
+	std::filesystem::remove(partialPath.getString().cppStr(), ec);
+	std::filesystem::remove(partialInfoPath.getString().cppStr(), ec);
+	segments.clear();
+	totalSize = 0;
+}
+
+bool FileDownloader::planSegments()
+{
+	segments.clear();
+
+	{
+		std::ofstream file(partialPath.getString().cppStr(), std::ios::binary | std::ios::trunc);
+		if (!file) {
+			Logger::logError("Unable to open " + partialPath.getNativeString(false) + " for writing.");
+			return false;
+		}
+	}
+
+	// Preallocate, so segments can be written in place as they arrive
+	std::error_code ec;
+	std::filesystem::resize_file(partialPath.getString().cppStr(), totalSize, ec);
+	if (ec) {
+		Logger::logError("Unable to allocate " + String::prettySize(totalSize) + " for " + partialPath.getNativeString(false));
+		return false;
+	}
+
+	const auto n = std::clamp<uint64_t>(totalSize / chunkSize, 1, static_cast<uint64_t>(maxConnections));
+	const auto segmentSize = (totalSize + n - 1) / n;
+	for (uint64_t i = 0; i < n; ++i) {
+		segments.push_back(std::make_unique<Segment>());
+		auto& segment = *segments.back();
+		segment.start = i * segmentSize;
+		segment.end = std::min(segment.start + segmentSize, totalSize);
+	}
+	return true;
+}
+
+bool FileDownloader::openSegment(Segment& segment)
+{
+	segment.file.open(partialPath.getString().cppStr(), std::ios::binary | std::ios::in | std::ios::out);
+	if (!segment.file) {
+		Logger::logError("Unable to open " + partialPath.getNativeString(false) + " for writing.");
+		return false;
+	}
+	return true;
+}
+
+std::unique_ptr<HTTPRequest> FileDownloader::makeRequest(const String& range)
+{
+	auto request = webAPI.makeHTTPRequest(HTTPMethod::GET, resolvedUrl);
+	for (const auto& [name, value]: headers) {
+		request->setHeader(name, value);
+	}
+	request->setHeader("Range", "bytes=" + range);
+	return request;
+}
+
+void FileDownloader::probeRanges(int depth)
+{
+	// Ask for a single byte first, following redirects. A 206 means the server honours ranges on the resolved URL.
+	// Servers that don't will send a 200 with the whole file instead, in which case we're done.
+	auto request = makeRequest("0-0");
+	request->setProgressCallback([this, self = shared_from_this()] (uint64_t cur, uint64_t total) -> bool
+	{
+		return reportProgress();
+	});
+	request->send().then([this, self = shared_from_this(), depth] (std::unique_ptr<HTTPResponse> response)
+	{
+		const auto code = response->getResponseCode();
+		lastResponseCode = code;
+		if (cancelled) {
+			finish(false);
+		} else if (code == 206) {
+			probeSize(depth);
+		} else if (code == 200) {
+			onWholeFileReceived(response->moveBody());
+		} else if ((code == 301 || code == 302) && depth < maxRedirects) {
+			resolvedUrl = response->getRedirectLocation();
+			probeRanges(depth + 1);
+		} else {
+			Logger::logError("HTTP Error " + toString(code) + " downloading " + resolvedUrl);
+			finish(false);
+		}
+	});
+}
+
+void FileDownloader::probeSize(int depth)
+{
+	// The web API doesn't expose Content-Range, so the size is taken from the length of an open-ended range instead,
+	// on the URL that has just answered a range request with 206. The request is aborted as soon as that length is known.
+	auto aborted = std::make_shared<std::atomic<bool>>(false);
+	auto probedSize = std::make_shared<std::atomic<uint64_t>>(0);
+
+	auto request = makeRequest("0-");
+	request->setProgressCallback([this, self = shared_from_this(), aborted, probedSize] (uint64_t cur, uint64_t total) -> bool
+	{
+		if (total > 0) {
+			*probedSize = total;
+			*aborted = true;
+			return false;
+		}
+		return reportProgress();
+	});
+	request->send().then([this, self = shared_from_this(), aborted, probedSize, depth] (std::unique_ptr<HTTPResponse> response)
+	{
+		const auto code = response->getResponseCode();
+		lastResponseCode = code;
+		if (cancelled) {
+			finish(false);
+		} else if ((code == 301 || code == 302) && depth < maxRedirects) {
+			// Moved between the two probes
+			resolvedUrl = response->getRedirectLocation();
+			probeRanges(depth + 1);
+		} else if (code != 0 && code != 206) {
+			Logger::logError("HTTP Error " + toString(code) + " probing size of " + resolvedUrl);
+			finish(false);
+		} else if (!*aborted) {
+			// No length was sent, so the whole file came through
+			onWholeFileReceived(response->moveBody());
+		} else if (!segments.empty() && totalSize == *probedSize) {
+			Logger::logInfo("Resuming download of " + url);
+			savePartialInfo();
+			startSegments();
+		} else {
+			discardPartial();
+			totalSize = *probedSize;
+			if (planSegments()) {
+				startSegments();
+			} else {
+				finish(false);
+			}
+		}
+	});
+}
+
+void FileDownloader::startSegments()
+{
+	Vector<Segment*> toStart;
+	{
+		auto lock = std::unique_lock(mutex);
+		for (auto& segment: segments) {
+			if (!segment->isComplete()) {
+				toStart.push_back(segment.get());
+				++activeSegments;
+			}
+		}
+	}
+
+	if (toStart.empty()) {
+		finish(true);
+		return;
+	}
+
+	for (auto* segment: toStart) {
+		if (openSegment(*segment)) {
+			requestChunk(*segment);
+		} else {
+			onSegmentEnded(false);
+		}
+	}
+}
+
+void FileDownloader::requestChunk(Segment& segment)
+{
+	const uint64_t start = segment.getPosition();
+	const uint64_t end = std::min(start + chunkSize, segment.end);
+
+	auto request = makeRequest(toString(start) + "-" + toString(end - 1));
+	request->setProgressCallback([this, self = shared_from_this(), &segment, size = end - start] (uint64_t cur, uint64_t total) -> bool
+	{
+		if (cur > size || total > size) {
+			// Not the range we asked for, so don't bother receiving the rest of it
+			return false;
+		}
+		{
+			auto lock = std::unique_lock(mutex);
+			segment.inFlight = cur;
+		}
+		return reportProgress();
+	});
+	request->send().then([this, self = shared_from_this(), &segment, start, end] (std::unique_ptr<HTTPResponse> response)
+	{
+		onChunkReceived(segment, start, end, std::move(response));
+	});
+}
+
+void FileDownloader::onChunkReceived(Segment& segment, uint64_t start, uint64_t end, std::unique_ptr<HTTPResponse> response)
+{
+	bool stop;
+	{
+		auto lock = std::unique_lock(mutex);
+		segment.inFlight = 0;
+		stop = failed || cancelled;
+	}
+	if (stop) {
+		onSegmentEnded(false);
+		return;
+	}
+
+	const auto code = response->getResponseCode();
+	lastResponseCode = code;
+	if (code == 206) {
+		const auto bytes = response->moveBody();
+		if (bytes.size() > end - start) {
+			// Content-Range isn't exposed, so a body longer than what was asked for is the only sign of the wrong range
+			Logger::logError("Server sent " + toString(bytes.size()) + " bytes for a range of " + toString(end - start) + " downloading " + resolvedUrl);
+			onSegmentEnded(false);
+			return;
+		}
+
+		segment.file.seekp(static_cast<std::streamoff>(start));
+		segment.file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+		segment.file.flush();
+		if (!segment.file) {
+			Logger::logError("Could not write " + toString(bytes.size()) + " bytes to " + partialPath.getNativeString(false));
+			onSegmentEnded(false);
+			return;
+		}
+
+		{
+			auto lock = std::unique_lock(mutex);
+			segment.written += bytes.size();
+		}
+
+		if (bytes.size() < end - start) {
+			Logger::logError("Server sent a short range downloading " + resolvedUrl);
+			onSegmentEnded(false);
+		} else if (segment.isComplete()) {
+			onSegmentEnded(true);
+		} else {
+			savePartialInfo();
+			requestChunk(segment);
+		}
+		feedStream(getContiguousSize());
+	} else if (code == 200) {
+		// Ranges worked when probing, so something in between is ignoring them now. Start over next time.
+		Logger::logWarning("Server ignored range request, restarting download of " + resolvedUrl);
+		{
+			auto lock = std::unique_lock(mutex);
+			totalSize = 0;
+		}
+		onSegmentEnded(false);
+	} else {
+		Logger::logError("HTTP Error " + toString(code) + " downloading " + resolvedUrl);
+		onSegmentEnded(false);
+	}
+}
+
+void FileDownloader::onSegmentEnded(bool ok)
+{
+	bool last;
+	{
+		auto lock = std::unique_lock(mutex);
+		if (!ok) {
+			failed = true;
+		}
+		last = --activeSegments == 0;
+	}
+
+	if (last) {
+		finish(!failed);
+	}
+}
+
+void FileDownloader::onWholeFileReceived(Bytes bytes)
+{
+	for (auto& segment: segments) {
+		segment->file.close();
+	}
+	segments.clear();
+	activeSegments = 0;
+
+	std::ofstream file(partialPath.getString().cppStr(), std::ios::binary | std::ios::trunc);
+	file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+	file.close();
+	if (!file) {
+		Logger::logError("Could not write " + toString(bytes.size()) + " bytes to " + partialPath.getNativeString(false));
+	} else {
+		feedStream(bytes.size());
+	}
+	finish(!!file);
+}
+
+bool FileDownloader::reportProgress()
+{
+	uint64_t cur = 0;
+	{
+		auto lock = std::unique_lock(mutex);
+		for (const auto& segment: segments) {
+			cur += segment->written + segment->inFlight;
+		}
+	}
+
+	if (progressCallback && !progressCallback(cur, std::max(totalSize, cur))) {
+		cancelled = true;
+	}
+	return !cancelled;
+}
+
+uint64_t FileDownloader::getContiguousSize()
+{
+	auto lock = std::unique_lock(mutex);
+	uint64_t size = 0;
+	for (const auto& segment: segments) {
+		size = segment->getPosition();
+		if (!segment->isComplete()) {
+			break;
+		}
+	}
+	return size;
+}
+
+void FileDownloader::feedStream(uint64_t available)
+{
+	// Consumers can be slow (e.g. inflating and writing files), so they're never run on the thread delivering responses
+	auto lock = std::unique_lock(streamMutex);
+	streamAvailable = std::max(streamAvailable, available);
+	scheduleStream();
+}
+
+void FileDownloader::scheduleStream()
+{
+	if (!streamRunning) {
+		streamRunning = true;
+		Concurrent::execute(Executors::getCPU(), [this, self = shared_from_this()] ()
+		{
+			runStream();
+		});
+	}
+}
+
+void FileDownloader::runStream()
+{
+	// Only one of these runs at a time, so the stream's file, hasher and callback are only touched here
+	auto lock = std::unique_lock(streamMutex);
+	while (!streamFailed && streamPosition < streamAvailable) {
+		const auto available = streamAvailable;
+		const auto position = streamPosition;
+		lock.unlock();
+		const auto newPosition = readStream(position, available);
+		lock.lock();
+		streamPosition = newPosition;
+	}
+	streamRunning = false;
+
+	if (pendingFinish) {
+		const bool ok = *pendingFinish;
+		pendingFinish.reset();
+		lock.unlock();
+		completeFinish(ok);
+	}
+}
+
+uint64_t FileDownloader::readStream(uint64_t position, uint64_t available)
+{
+	// Read back what's been written, rather than holding on to chunks which arrive out of order
+	if (!streamFile.is_open()) {
+		streamFile.open(partialPath.getString().cppStr(), std::ios::binary);
+	}
+	streamFile.clear();
+	streamFile.seekg(static_cast<std::streamoff>(position));
+
+	Vector<char> block(static_cast<size_t>(std::min<uint64_t>(streamBlockSize, available - position)));
+	while (position < available) {
+		const auto n = static_cast<size_t>(std::min<uint64_t>(block.size(), available - position));
+		streamFile.read(block.data(), static_cast<std::streamsize>(n));
+		if (!streamFile) {
+			Logger::logWarning("Unable to read back " + partialPath.getNativeString(false));
+			streamFile.close();
+			auto lock = std::unique_lock(streamMutex);
+			streamFailed = true;
+			return position;
+		}
+
+		const auto data = gsl::as_bytes(gsl::span<const char>(block.data(), n));
+		hasher.feed(data);
+		if (streamCallback && !streamCallback(data)) {
+			streamCallback = {};
+		}
+		position += n;
+	}
+	return position;
+}
+
+void FileDownloader::closeStream(bool ok)
+{
+	std::error_code ec;
+	const auto size = std::filesystem::file_size(partialPath.getString().cppStr(), ec);
+
+	// The partial file gets renamed once we're done, which some platforms won't allow while it's open
+	auto lock = std::unique_lock(streamMutex);
+	streamCallback = {};
+	streamFile.close();
+	if (ok && !ec && !streamFailed && streamPosition == size) {
+		digest = hasher.digest();
+	}
+}
+
+std::optional<Bytes> FileDownloader::getDigest() const
+{
+	return digest;
+}
+
+void FileDownloader::finish(bool ok)
+{
+	{
+		auto lock = std::unique_lock(mutex);
+		if (finished) {
+			return;
+		}
+		finished = true;
+	}
+
+	for (auto& segment: segments) {
+		segment->file.close();
+	}
+
+	// Let the stream catch up with everything that's been written first, then finish from there
+	const auto available = ok && !segments.empty() ? getContiguousSize() : 0;
+	auto lock = std::unique_lock(streamMutex);
+	streamAvailable = std::max(streamAvailable, available);
+	pendingFinish = ok;
+	streamFailed = streamFailed || !ok;
+	scheduleStream();
+}
+
+void FileDownloader::completeFinish(bool ok)
+{
+	closeStream(ok);
+
+	std::error_code ec;
+	if (ok) {
+		std::filesystem::remove(destination.getString().cppStr(), ec);
+		std::filesystem::rename(partialPath.getString().cppStr(), destination.getString().cppStr(), ec);
+		if (ec) {
+			Logger::logError("Unable to move download to " + destination.getNativeString(false));
+			ok = false;
+		}
+		std::filesystem::remove(partialInfoPath.getString().cppStr(), ec);
+	} else if (resumable && totalSize > 0 && !segments.empty()) {
+		// Keep what we have, so the next attempt can resume from here
+		savePartialInfo();
+	} else {
+		discardPartial();
+	}
+
+	promise.setValue(ok);
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <halley.hpp>
+
+#include <fstream>
+
+#include "sha256.h"
+using namespace Halley;
+
+// Downloads a file straight to disk, requesting it in fixed-size chunks via HTTP Range,
+// so memory use is bounded by the chunk size rather than the size of the file.
+// Large files are split into segments which are fetched over several connections at once.
+// Falls back to a single request if the server doesn't support ranges. Redirects are followed before any size is trusted.
+// Interrupted downloads are kept next to the destination, keyed by the requested URL, and resumed on the next attempt.
+// The web API doesn't expose response headers, so there's no validator to resume against: a resumed download is only kept
+// if the server still reports the same size, and any other change is caught by the caller checking the final digest.
+// The file is read back in order as it arrives, so it can be hashed and streamed to a consumer while it's still downloading.
+// That happens on a CPU worker, one block at a time, so a slow consumer never holds up the thread delivering responses.
+class FileDownloader : public std::enable_shared_from_this<FileDownloader> {
+public:
+	using ProgressCallback = std::function<bool(uint64_t, uint64_t)>;
+	// Receives the file in order from its first byte, as soon as each part is on disk. Called on a CPU worker, never on
+	// two threads at once. Return false to stop streaming.
+	using StreamCallback = std::function<bool(gsl::span<const gsl::byte>)>;
+
+	constexpr static uint64_t defaultChunkSize = 8 * 1024 * 1024;
+	constexpr static int defaultConnections = 4;
+
+	FileDownloader(WebAPI& webAPI, String url, Path destination, uint64_t chunkSize = defaultChunkSize);
+
+	void setProgressCallback(ProgressCallback callback);
+	void setStreamCallback(StreamCallback callback);
+	void setMaxConnections(int connections);
+	// Sent with every request, e.g. for authorization
+	void setHeader(String name, String value);
+	// Downloads which can change on the server without their size changing should always start over
+	void setResumable(bool resumable);
+	Future<bool> start();
+
+	const Path& getDestination() const;
+	// Status code of the last response, so callers can tell why a download failed
+	int getLastResponseCode() const;
+
+	// SHA-256 of the file, computed while downloading. Only available once the download has succeeded.
+	std::optional<Bytes> getDigest() const;
+
+private:
+	constexpr static int maxRedirects = 3;
+	constexpr static size_t streamBlockSize = 1024 * 1024;
+
+	struct Segment {
+		uint64_t start = 0;
+		uint64_t end = 0; // Exclusive, 0 if the total size is unknown
+		uint64_t written = 0;
+		uint64_t inFlight = 0;
+		bool done = false;
+		std::fstream file;
+
+		uint64_t getPosition() const;
+		bool isComplete() const;
+	};
+
+	WebAPI& webAPI;
+	String url;
+	String resolvedUrl;
+	Path destination;
+	Path partialPath;
+	Path partialInfoPath;
+	uint64_t chunkSize;
+	int maxConnections = 1;
+	bool resumable = true;
+	Vector<std::pair<String, String>> headers;
+	ProgressCallback progressCallback;
+
+	Promise<bool> promise;
+	std::mutex mutex;
+	Vector<std::unique_ptr<Segment>> segments;
+	uint64_t totalSize = 0;
+	int activeSegments = 0;
+	bool failed = false;
+	bool finished = false;
+	std::atomic<bool> cancelled = false;
+	std::atomic<int> lastResponseCode = 0;
+
+	std::mutex streamMutex;
+	StreamCallback streamCallback;
+	std::ifstream streamFile;
+	uint64_t streamPosition = 0;
+	uint64_t streamAvailable = 0;
+	bool streamRunning = false;
+	bool streamFailed = false;
+	std::optional<bool> pendingFinish;
+	SHA256Hasher hasher;
+	std::optional<Bytes> digest;
+
+	void loadPartial();
+	void savePartialInfo();
+	void discardPartial();
+	bool planSegments();
+	bool openSegment(Segment& segment);
+	std::unique_ptr<HTTPRequest> makeRequest(const String& range);
+
+	void probeRanges(int depth = 0);
+	void probeSize(int depth);
+	void startSegments();
+	void requestChunk(Segment& segment);
+	void onChunkReceived(Segment& segment, uint64_t start, uint64_t end, std::unique_ptr<HTTPResponse> response);
+	void onSegmentEnded(bool ok);
+	void onWholeFileReceived(Bytes bytes);
+
+	bool reportProgress();
+	uint64_t getContiguousSize();
+	void feedStream(uint64_t available);
+	void scheduleStream();
+	void runStream();
+	uint64_t readStream(uint64_t position, uint64_t available);
+	void closeStream(bool ok);
+	void finish(bool ok);
+	void completeFinish(bool ok);
+};
@@ -0,0 +1,81 @@
+#include "file_lock.h"
+
+#include <filesystem>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+#endif
+
+FileLock::FileLock(const Path& path)
+{
+	std::error_code ec;
+	std::filesystem::create_directories(path.parentPath().getString().cppStr(), ec);
+
+#ifdef _WIN32
+	const auto widePath = std::filesystem::path(path.getString().cppStr()).wstring();
+	HANDLE file = CreateFileW(widePath.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		Logger::logError("Unable to open lock file " + path.getNativeString(false));
+		return;
+	}
+
+	OVERLAPPED overlapped = {};
+	if (!LockFileEx(file, LOCKFILE_EXCLUSIVE_LOCK, 0, MAXDWORD, MAXDWORD, &overlapped)) {
+		Logger::logError("Unable to lock " + path.getNativeString(false));
+		CloseHandle(file);
+		return;
+	}
+	handle = file;
+#else
+	const int file = ::open(path.getString().c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+	if (file < 0) {
+		Logger::logError("Unable to open lock file " + path.getNativeString(false));
+		return;
+	}
+
+	int result;
+	do {
+		result = flock(file, LOCK_EX);
+	} while (result != 0 && errno == EINTR);
+	if (result != 0) {
+		Logger::logError("Unable to lock " + path.getNativeString(false));
+		::close(file);
+		return;
+	}
+	fd = file;
+#endif
+}
+
+FileLock::~FileLock()
+{
+	// Closing the file releases the lock
+#ifdef _WIN32
+	if (handle) {
+		CloseHandle(static_cast<HANDLE>(handle));
+	}
+#else
+	if (fd >= 0) {
+		::close(fd);
+	}
+#endif
+}
+
+bool FileLock::isLocked() const
+{
+#ifdef _WIN32
+	return handle != nullptr;
+#else
+	return fd >= 0;
+#endif
+}
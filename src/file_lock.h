@@ -0,0 +1,24 @@
+#pragma once
+
+#include <halley.hpp>
+using namespace Halley;
+
+// Exclusive lock on a file, held for the lifetime of the object, so several launcher processes can share files on disk.
+// Blocks until the lock is acquired. The lock file is created if it doesn't exist, and is left behind afterwards.
+class FileLock {
+public:
+	explicit FileLock(const Path& path);
+	~FileLock();
+
+	FileLock(const FileLock& other) = delete;
+	FileLock& operator=(const FileLock& other) = delete;
+
+	bool isLocked() const;
+
+private:
+#ifdef _WIN32
+	void* handle = nullptr;
+#else
+	int fd = -1;
+#endif
+};
@@ -0,0 +1,158 @@
+#include "file_writer.h"
+
+#include <filesystem>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+FileWriter::FileWriter(size_t bufferSize)
+	: buffer(std::max<size_t>(bufferSize, 1))
+{
+}
+
+FileWriter::~FileWriter()
+{
+	close();
+}
+
+bool FileWriter::open(const Path& path, uint64_t expectedSize)
+{
+	close();
+
+#ifdef _WIN32
+	const auto widePath = std::filesystem::path(path.getString().cppStr()).wstring();
+	HANDLE file = CreateFileW(widePath.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+	handle = file;
+#else
+	fd = ::open(path.getString().c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (fd < 0) {
+		return false;
+	}
+#endif
+
+	buffered = 0;
+	ok = true;
+	if (expectedSize > buffer.size()) {
+		preallocate(expectedSize);
+	}
+	return true;
+}
+
+bool FileWriter::write(gsl::span<const gsl::byte> data)
+{
+	if (!ok) {
+		return false;
+	}
+
+	if (buffered + data.size() > buffer.size()) {
+		if (!flush()) {
+			return false;
+		}
+		if (data.size() >= buffer.size()) {
+			ok = writeToFile(data);
+			return ok;
+		}
+	}
+
+	memcpy(buffer.data() + buffered, data.data(), data.size());
+	buffered += data.size();
+	return true;
+}
+
+bool FileWriter::close()
+{
+	if (!isOpen()) {
+		return false;
+	}
+
+	flush();
+	closeHandle();
+	const bool result = ok;
+	ok = false;
+	return result;
+}
+
+bool FileWriter::isOpen() const
+{
+#ifdef _WIN32
+	return handle != nullptr;
+#else
+	return fd >= 0;
+#endif
+}
+
+void FileWriter::preallocate(uint64_t size)
+{
+	// Failing to reserve space isn't an error, as the writes will still allocate it as they go
+#ifdef _WIN32
+	FILE_ALLOCATION_INFO info;
+	info.AllocationSize.QuadPart = static_cast<LONGLONG>(size);
+	SetFileInformationByHandle(static_cast<HANDLE>(handle), FileAllocationInfo, &info, sizeof(info));
+#elif defined(__linux__)
+	// Not posix_fallocate, which falls back to writing zeroes on filesystems that can't reserve space
+	fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, static_cast<off_t>(size));
+#else
+	(void)size;
+#endif
+}
+
+bool FileWriter::flush()
+{
+	if (ok && buffered > 0) {
+		ok = writeToFile(gsl::span<const gsl::byte>(buffer.data(), buffered));
+	}
+	buffered = 0;
+	return ok;
+}
+
+bool FileWriter::writeToFile(gsl::span<const gsl::byte> data)
+{
+	while (!data.empty()) {
+#ifdef _WIN32
+		const auto toWrite = static_cast<DWORD>(std::min<size_t>(data.size(), 1 << 30));
+		DWORD n = 0;
+		if (!WriteFile(static_cast<HANDLE>(handle), data.data(), toWrite, &n, nullptr) || n == 0) {
+			return false;
+		}
+#else
+		const auto n = ::write(fd, data.data(), data.size());
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+		if (n <= 0) {
+			return false;
+		}
+#endif
+		data = data.subspan(static_cast<size_t>(n));
+	}
+	return true;
+}
+
+void FileWriter::closeHandle()
+{
+#ifdef _WIN32
+	if (!CloseHandle(static_cast<HANDLE>(handle))) {
+		ok = false;
+	}
+	handle = nullptr;
+#else
+	if (::close(fd) != 0) {
+		ok = false;
+	}
+	fd = -1;
+#endif
+}
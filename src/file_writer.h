@@ -0,0 +1,42 @@
+#pragma once
+
+#include <halley.hpp>
+using namespace Halley;
+
+// Writes files through a raw OS handle, gathering small writes in a buffer which is kept across files.
+// One writer is meant to be reused for many files in a row (e.g. by an extraction worker), so writing lots of small files costs
+// one system call each, and nothing is reallocated between them. Writes larger than the buffer skip it and go straight to disk.
+// When the final size is known up front, the space is reserved in one go so large files aren't fragmented as they grow. The
+// reservation doesn't change the file's apparent size, so a file left behind by an aborted write never looks complete.
+class FileWriter {
+public:
+	FileWriter(size_t bufferSize = 256 * 1024);
+	~FileWriter();
+
+	FileWriter(const FileWriter& other) = delete;
+	FileWriter& operator=(const FileWriter& other) = delete;
+
+	// Creates or truncates the file. expectedSize is only a hint for preallocation, and can be left at 0 if unknown.
+	bool open(const Path& path, uint64_t expectedSize = 0);
+	bool write(gsl::span<const gsl::byte> data);
+
+	// Flushes and closes the file, returning false if any write failed
+	bool close();
+
+	bool isOpen() const;
+
+private:
+#ifdef _WIN32
+	void* handle = nullptr;
+#else
+	int fd = -1;
+#endif
+	Vector<gsl::byte> buffer;
+	size_t buffered = 0;
+	bool ok = false;
+
+	void preallocate(uint64_t size);
+	bool flush();
+	bool writeToFile(gsl::span<const gsl::byte> data);
+	void closeHandle();
+};
@@ -0,0 +1,180 @@
+#include "gzip_decoder.h"
+
+namespace {
+	constexpr uint8_t flagHeaderCRC = 0x02;
+	constexpr uint8_t flagExtra = 0x04;
+	constexpr uint8_t flagName = 0x08;
+	constexpr uint8_t flagComment = 0x10;
+
+	constexpr size_t magicSize = 3;
+	constexpr size_t headerSize = 10;
+	constexpr size_t trailerSize = 8;
+
+	uint32_t readLE32(const uint8_t* data)
+	{
+		return uint32_t(data[0]) | (uint32_t(data[1]) << 8) | (uint32_t(data[2]) << 16) | (uint32_t(data[3]) << 24);
+	}
+}
+
+GZipDecoder::GZipDecoder(OutputCallback output, bool allowPlain)
+	: output(std::move(output))
+	, allowPlain(allowPlain)
+	, inflater([this] (gsl::span<const gsl::byte> data) -> bool
+	{
+		crc.feed(data);
+		return !this->output || this->output(data);
+	})
+{
+}
+
+bool GZipDecoder::feed(gsl::span<const gsl::byte> data)
+{
+	if (state == State::Error) {
+		return false;
+	}
+	if (state == State::Plain) {
+		if (output && !output(data)) {
+			state = State::Error;
+			return false;
+		}
+		return true;
+	}
+
+	if (state == State::Header) {
+		const auto* src = reinterpret_cast<const uint8_t*>(data.data());
+		buffer.insert(buffer.end(), src, src + data.size());
+		if (allowPlain && buffer.size() >= magicSize && !isGZip(gsl::as_bytes(gsl::span<const uint8_t>(buffer.data(), buffer.size())))) {
+			return passThrough();
+		}
+		if (!parseHeader()) {
+			return state != State::Error;
+		}
+		data = {};
+	}
+
+	if (state == State::Body) {
+		if (!inflater.feed(data)) {
+			state = State::Error;
+			return false;
+		}
+		if (!inflater.isDone()) {
+			return true;
+		}
+		const auto remaining = inflater.getRemainingInput();
+		const auto* src = reinterpret_cast<const uint8_t*>(remaining.data());
+		buffer.assign(src, src + remaining.size());
+		state = State::Trailer;
+	} else if (state == State::Trailer) {
+		const auto* src = reinterpret_cast<const uint8_t*>(data.data());
+		buffer.insert(buffer.end(), src, src + data.size());
+	}
+
+	if (state == State::Trailer && buffer.size() >= trailerSize) {
+		state = checkTrailer() ? State::Done : State::Error;
+	}
+	return state != State::Error;
+}
+
+bool GZipDecoder::finish()
+{
+	// Anything too short to hold the magic number can't be gzip
+	if (state == State::Header && allowPlain) {
+		passThrough();
+	}
+	return state == State::Done || state == State::Plain;
+}
+
+bool GZipDecoder::isGZip(gsl::span<const gsl::byte> data)
+{
+	return data.size() >= magicSize
+		&& static_cast<uint8_t>(data[0]) == 0x1F
+		&& static_cast<uint8_t>(data[1]) == 0x8B
+		&& static_cast<uint8_t>(data[2]) == 8;
+}
+
+std::optional<Bytes> GZipDecoder::decodeIfCompressed(Bytes data)
+{
+	if (!isGZip(data.byte_span())) {
+		return data;
+	}
+
+	Bytes result;
+	GZipDecoder decoder([&] (gsl::span<const gsl::byte> chunk) -> bool
+	{
+		const auto offset = result.size();
+		result.resize(offset + chunk.size());
+		memcpy(result.data() + offset, chunk.data(), chunk.size());
+		return true;
+	});
+
+	if (!decoder.feed(data.byte_span()) || !decoder.finish()) {
+		return std::nullopt;
+	}
+	return result;
+}
+
+bool GZipDecoder::parseHeader()
+{
+	// Returns true once the whole header has been consumed
+	if (buffer.size() < headerSize) {
+		return false;
+	}
+	if (!isGZip(gsl::as_bytes(gsl::span<const uint8_t>(buffer.data(), buffer.size())))) {
+		state = State::Error;
+		return false;
+	}
+
+	const uint8_t flags = buffer[3];
+	size_t pos = headerSize;
+	if (flags & flagExtra) {
+		if (buffer.size() < pos + 2) {
+			return false;
+		}
+		pos += 2 + (size_t(buffer[pos]) | (size_t(buffer[pos + 1]) << 8));
+	}
+	for (const auto flag: { flagName, flagComment }) {
+		if (flags & flag) {
+			while (pos < buffer.size() && buffer[pos] != 0) {
+				++pos;
+			}
+			++pos;
+		}
+	}
+	if (flags & flagHeaderCRC) {
+		pos += 2;
+	}
+	if (pos > buffer.size()) {
+		return false;
+	}
+
+	state = State::Body;
+	Vector<uint8_t> body(buffer.begin() + static_cast<ptrdiff_t>(pos), buffer.end());
+	buffer.clear();
+	if (!inflater.feed(gsl::as_bytes(gsl::span<const uint8_t>(body.data(), body.size())))) {
+		state = State::Error;
+		return false;
+	}
+	return true;
+}
+
+bool GZipDecoder::passThrough()
+{
+	state = State::Plain;
+	const bool ok = !output || output(gsl::as_bytes(gsl::span<const uint8_t>(buffer.data(), buffer.size())));
+	buffer.clear();
+	if (!ok) {
+		state = State::Error;
+	}
+	return ok;
+}
+
+bool GZipDecoder::checkTrailer()
+{
+	const auto expectedCRC = readLE32(buffer.data());
+	const auto expectedSize = readLE32(buffer.data() + 4);
+	if (expectedCRC != crc.get() || expectedSize != static_cast<uint32_t>(inflater.getTotalOut())) {
+		Logger::logError("Corrupt gzip data");
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <halley.hpp>
+
+#include "crc32.h"
+#include "inflater.h"
+using namespace Halley;
+
+// Streaming decoder for gzip (RFC 1952) data, as sent by servers for "Content-Encoding: gzip".
+// Only the header and trailer are handled here, the deflate data in between is decoded by miniz through Inflater.
+// The web API doesn't expose response headers, so compressed bodies are recognised by the gzip magic number instead.
+class GZipDecoder {
+public:
+	using OutputCallback = Inflater::OutputCallback;
+
+	// With allowPlain, data that doesn't start with a gzip header is passed through unchanged, for servers that ignore Accept-Encoding
+	GZipDecoder(OutputCallback output, bool allowPlain = false);
+
+	bool feed(gsl::span<const gsl::byte> data);
+	// Returns true if the whole stream was received and its checksum matched
+	bool finish();
+
+	static bool isGZip(gsl::span<const gsl::byte> data);
+
+	// Decodes a whole body, or returns it unchanged if it's not gzip. Returns std::nullopt if it's corrupt.
+	static std::optional<Bytes> decodeIfCompressed(Bytes data);
+
+private:
+	enum class State {
+		Header,
+		Body,
+		Trailer,
+		Done,
+		Plain,
+		Error
+	};
+
+	OutputCallback output;
+	bool allowPlain;
+	Inflater inflater;
+	CRC32 crc;
+	State state = State::Header;
+	Vector<uint8_t> buffer;
+
+	bool parseHeader();
+	bool passThrough();
+	bool checkTrailer();
+};
@@ -0,0 +1,106 @@
+#include "inflater.h"
+
+#define MINIZ_NO_ZLIB_COMPATIBLE_NAMES
+#include <miniz.h>
+
+struct Inflater::Stream {
+	mz_stream z = {};
+};
+
+Inflater::Inflater(OutputCallback output)
+	: output(std::move(output))
+	, stream(std::make_unique<Stream>())
+	, out(outputSize)
+{
+	// Negative window bits select raw deflate, without a zlib header or trailer
+	if (mz_inflateInit2(&stream->z, -MZ_DEFAULT_WINDOW_BITS) != MZ_OK) {
+		state = State::Error;
+	}
+}
+
+Inflater::~Inflater()
+{
+	mz_inflateEnd(&stream->z);
+}
+
+bool Inflater::feed(gsl::span<const gsl::byte> data)
+{
+	if (state == State::Done) {
+		remaining.insert(remaining.end(), data.begin(), data.end());
+		return true;
+	}
+	if (state == State::Error) {
+		return false;
+	}
+
+	auto& z = stream->z;
+	size_t pos = 0;
+	do {
+		// miniz counts input in 32 bits, so very large spans go in several passes
+		const auto n = std::min(data.size() - pos, maxInputSize);
+		z.next_in = reinterpret_cast<const unsigned char*>(data.data() + pos);
+		z.avail_in = static_cast<unsigned int>(n);
+		pos += n;
+
+		if (!decode()) {
+			state = State::Error;
+			return false;
+		}
+		if (state == State::Done) {
+			const auto* end = reinterpret_cast<const unsigned char*>(data.data() + data.size());
+			remaining.assign(reinterpret_cast<const gsl::byte*>(z.next_in), reinterpret_cast<const gsl::byte*>(end));
+			return true;
+		}
+	} while (pos < data.size());
+
+	return true;
+}
+
+bool Inflater::isDone() const
+{
+	return state == State::Done;
+}
+
+uint64_t Inflater::getTotalOut() const
+{
+	return totalOut;
+}
+
+gsl::span<const gsl::byte> Inflater::getRemainingInput() const
+{
+	if (state != State::Done) {
+		return {};
+	}
+	return remaining;
+}
+
+bool Inflater::decode()
+{
+	// Runs until miniz has taken all the input, handing on each full output buffer as it goes
+	auto& z = stream->z;
+	while (true) {
+		z.next_out = reinterpret_cast<unsigned char*>(out.data());
+		z.avail_out = static_cast<unsigned int>(out.size());
+		const auto result = mz_inflate(&z, MZ_NO_FLUSH);
+
+		const size_t produced = out.size() - z.avail_out;
+		if (produced > 0) {
+			totalOut += produced;
+			if (output && !output(gsl::span<const gsl::byte>(out.data(), produced))) {
+				return false;
+			}
+		}
+
+		if (result == MZ_STREAM_END) {
+			state = State::Done;
+			return true;
+		}
+		if (result != MZ_OK && result != MZ_BUF_ERROR) {
+			return false;
+		}
+		if (z.avail_out != 0) {
+			// Out of input. Running out of neither means miniz can't make progress on what it has.
+			return z.avail_in == 0;
+		}
+	}
+}
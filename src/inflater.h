@@ -0,0 +1,50 @@
+#pragma once
+
+#include <halley.hpp>
+using namespace Halley;
+
+// Streaming decoder for raw DEFLATE (RFC 1951) data, on top of the engine's miniz.
+// Input can be fed in arbitrarily sized pieces, and decoded output is handed to the callback in blocks as it's produced,
+// so neither the compressed nor the decompressed data has to be held in memory in full.
+class Inflater {
+public:
+	// Return false to abort decoding
+	using OutputCallback = std::function<bool(gsl::span<const gsl::byte>)>;
+
+	Inflater(OutputCallback output);
+	~Inflater();
+
+	Inflater(const Inflater& other) = delete;
+	Inflater& operator=(const Inflater& other) = delete;
+
+	// Returns false if the data is corrupt or the output callback aborted
+	bool feed(gsl::span<const gsl::byte> data);
+
+	bool isDone() const;
+	uint64_t getTotalOut() const;
+
+	// Input received after the end of the deflate stream (e.g. a gzip trailer)
+	gsl::span<const gsl::byte> getRemainingInput() const;
+
+private:
+	constexpr static size_t outputSize = 256 * 1024;
+	constexpr static size_t maxInputSize = 1024 * 1024 * 1024;
+
+	enum class State {
+		Running,
+		Done,
+		Error
+	};
+
+	// Wraps miniz's stream, so its header (and its zlib-style macros) stay out of this one
+	struct Stream;
+
+	OutputCallback output;
+	std::unique_ptr<Stream> stream;
+	State state = State::Running;
+	Vector<gsl::byte> out;
+	Vector<gsl::byte> remaining;
+	uint64_t totalOut = 0;
+
+	bool decode();
+};
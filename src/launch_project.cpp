@@ -2,8 +2,12 @@
 
 #include <filesystem>
 
+#include "editor_patch.h"
+#include "launcher_signature.h"
 #include "launcher_stage.h"
 #include "launcher_project_properties.h"
+#include "zip_extractor.h"
+#include "zip_stream_extractor.h"
 using namespace Halley;
 
 LaunchProject::LaunchProject(UIFactory& factory, LauncherSettings& settings, ILauncher& parent, ProjectLocation project, bool safeMode)
@@ -15,7 +19,16 @@ LaunchProject::LaunchProject(UIFactory& factory, LauncherSettings& settings, ILa
 	, safeMode(safeMode)
 {
 	if (this->projectLocation.params.hasKey("url")) {
-		checkForProjectUpdates();
+		// Data a fast launch fetched in the background is applied now, before anything reads the project
+		if (!parent.getWebClient().applyPendingUpdate(this->projectLocation.path)) {
+			Logger::logWarning("Unable to apply the last project update, is the editor still running?");
+		}
+
+		if (settings.isFastLaunchEnabled() && canLaunchWithoutUpdate()) {
+			fastLaunch();
+		} else {
+			checkForProjectUpdates();
+		}
 	} else {
 		tryLaunching();
 	}
@@ -71,7 +84,7 @@ void LaunchProject::tryLaunching()
 		parent.switchTo("choose_project");
 	} else if (properties->builtVersion != properties->halleyVersion) {
 		if (projectLocation.params.hasKey("url")) {
-			downloadEditor(properties->halleyVersion);
+			downloadEditor(properties->halleyVersion, properties->builtVersion);
 		} else {
 			buildProject(properties->builtVersion < properties->cleanBuildIfOlderVersion);
 		}
@@ -111,37 +124,121 @@ void LaunchProject::buildProject(bool clean)
 	});
 }
 
-void LaunchProject::downloadEditor(HalleyVersion version)
+void LaunchProject::downloadEditor(HalleyVersion version, HalleyVersion installedVersion)
 {
 	loadUIIfNeeded();
+
+	if (auto archivePath = parent.getEditorStore()->getArchive(version)) {
+		log(LoggerLevel::Info, "Using stored Halley Editor version " + version.toString());
+		installEditor(std::move(*archivePath));
+	} else if (installedVersion != HalleyVersion() && installedVersion < version) {
+		downloadEditorPatch(installedVersion, version);
+	} else {
+		downloadFullEditor(version);
+	}
+}
+
+void LaunchProject::downloadFullEditor(HalleyVersion version)
+{
 	getWidgetAs<UILabel>("status")->setText(LocalisedString::fromHardcodedString("Downloading editor..."));
 
+	// Extract while downloading, but into a staging folder: nothing reaches the install until the signature has been checked.
+	// If the archive can't be streamed, it's installed from the stored copy afterwards.
+	const auto stagingPath = getStagingPath();
+	removeStaging();
+	auto extractor = std::make_shared<ZipStreamExtractor>(stagingPath);
+	auto streamCallback = [extractor] (gsl::span<const gsl::byte> data) -> bool
+	{
+		return extractor->feed(data);
+	};
+
 	setProgress(0, 1);
-	parent.getWebClient().downloadEditor(version, [=, flag = NonOwningAliveFlag(aliveFlag)] (uint64_t cur, uint64_t total) -> bool
+	parent.getWebClient().downloadEditor(version, makeProgressCallback(), std::move(streamCallback)).then(aliveFlag, Executors::getMainUpdateThread(), [=](std::optional<WebClient::DownloadedFile> download)
 	{
-		if (flag) {
-			setProgress(cur, total);
-			return true;
-		} else {
-			return false;
+		if (!download) {
+			removeStaging();
+			log(LoggerLevel::Error, "Unable to download Halley Editor version " + version.toString());
+			return;
 		}
-	}).then(aliveFlag, Executors::getMainUpdateThread(), [=](Bytes bytes)
+
+		getWidgetAs<UILabel>("status")->setText(LocalisedString::fromHardcodedString("Verifying editor..."));
+		Concurrent::execute([&resources = factory.getResources(), download = *download] () -> bool
+		{
+			return LauncherSignature::verifyFile(resources, download.signature.byte_span(), download.path);
+		}).then(aliveFlag, Executors::getMainUpdateThread(), [=, download = std::move(*download)] (bool valid) mutable
+		{
+			if (!valid) {
+				removeStaging();
+				std::error_code ec;
+				std::filesystem::remove(download.path.getString().cppStr(), ec);
+				log(LoggerLevel::Error, "Invalid signature on Halley Editor version " + version.toString() + ".");
+				return;
+			}
+
+			log(LoggerLevel::Info, "Download successful");
+			const bool installed = extractor->isDone() && commitStaging();
+			removeStaging();
+			storeEditor(version, std::move(download.path), std::move(download.sha256), installed);
+		});
+	});
+}
+
+void LaunchProject::downloadEditorPatch(HalleyVersion from, HalleyVersion to)
+{
+	getWidgetAs<UILabel>("status")->setText(LocalisedString::fromHardcodedString("Downloading editor update..."));
+
+	setProgress(0, 1);
+	parent.getWebClient().downloadEditorPatch(from, to, makeProgressCallback()).then(aliveFlag, Executors::getMainUpdateThread(), [=](std::optional<WebClient::DownloadedFile> patch)
 	{
-		if (bytes.empty()) {
-			log(LoggerLevel::Error, "Unable to download Halley Editor version " + version.toString());
+		if (!patch) {
+			log(LoggerLevel::Info, "No update available from Halley Editor version " + from.toString() + ", downloading full editor.");
+			downloadFullEditor(to);
+			return;
+		}
+
+		getWidgetAs<UILabel>("status")->setText(LocalisedString::fromHardcodedString("Updating editor..."));
+		Concurrent::execute([this, patch = std::move(*patch), path = projectLocation.path] () -> bool
+		{
+			return doPatchEditor(patch, path);
+		}).then(aliveFlag, Executors::getMainUpdateThread(), [=] (bool ok)
+		{
+			if (ok) {
+				launchProject();
+			} else {
+				log(LoggerLevel::Warning, "Unable to update Halley Editor from version " + from.toString() + ", downloading full editor.");
+				downloadFullEditor(to);
+			}
+		});
+	});
+}
+
+void LaunchProject::storeEditor(HalleyVersion version, Path archivePath, Bytes sha256, bool installed)
+{
+	getWidgetAs<UILabel>("status")->setText(LocalisedString::fromHardcodedString("Storing editor..."));
+	Concurrent::execute([editorStore = parent.getEditorStore(), version, archivePath = std::move(archivePath), sha256 = std::move(sha256)] ()
+	{
+		return editorStore->addArchive(version, archivePath, sha256);
+	}).then(aliveFlag, Executors::getMainUpdateThread(), [=] (std::optional<Path> storedPath)
+	{
+		if (installed) {
+			if (!storedPath) {
+				log(LoggerLevel::Warning, "Unable to store Halley Editor version " + version.toString());
+			}
+			launchProject();
+		} else if (storedPath) {
+			installEditor(*storedPath);
 		} else {
-			log(LoggerLevel::Info, "Download successful");
-			installEditor(bytes);
+			log(LoggerLevel::Error, "Unable to store Halley Editor version " + version.toString());
 		}
 	});
 }
 
-void LaunchProject::installEditor(Bytes data)
+void LaunchProject::installEditor(Path archivePath)
 {
 	getWidgetAs<UILabel>("status")->setText(LocalisedString::fromHardcodedString("Installing editor..."));
-	Concurrent::execute([this, data = std::move(data), path = projectLocation.path] () mutable -> bool
+	Concurrent::execute([this, archivePath = std::move(archivePath), path = projectLocation.path] () -> bool
 	{
-		return doInstallEditor(std::move(data), path);
+		return doInstallEditor(archivePath, path);
 	}).then(aliveFlag, Executors::getMainUpdateThread(), [=] (bool ok)
 	{
 		if (ok) {
@@ -152,52 +249,75 @@ void LaunchProject::installEditor(Bytes data)
 	});
 }
 
-bool LaunchProject::doInstallEditor(Bytes bytes, const Path& projectPath)
+bool LaunchProject::doInstallEditor(const Path& archivePath, const Path& projectPath)
 {
-	ZipFile zip;
-	bool success = zip.open(std::move(bytes));
-	if (!success) {
-		Concurrent::execute(Executors::getMainUpdateThread(), [this]()
+	ZipExtractor extractor(archivePath, projectPath);
+	extractor.setDifferential(parent.getProjectDataFolders().getFolder(projectPath) / "extract_index");
+	extractor.setProgressCallback([this] (uint64_t cur, uint64_t total) -> bool
+	{
+		setProgress(cur, total);
+		return true;
+	});
+
+	if (!extractor.extract()) {
+		const auto name = extractor.getFailedEntry();
+		Concurrent::execute(Executors::getMainUpdateThread(), [this, name]()
 		{
-			log(LoggerLevel::Error, "Unable to parse zip file.");
+			log(LoggerLevel::Error, name.isEmpty() ? String("Unable to parse zip file.") : "Unable to extract file from zip: " + name);
 		});
 		return false;
 	}
 
-	const auto rootPath = projectPath;
+	if (extractor.getNumFilesSkipped() > 0) {
+		Logger::logInfo("Skipped " + toString(extractor.getNumFilesSkipped()) + " unchanged editor files.");
+	}
+	return true;
+}
 
-	const auto n = zip.getNumFiles();
-	uint64_t totalSize = 0;
-	for (size_t i = 0; i < n; ++i) {
-		totalSize += zip.getFileSize(i);
+bool LaunchProject::doPatchEditor(const WebClient::DownloadedFile& download, const Path& projectPath)
+{
+	if (!LauncherSignature::verifyFile(factory.getResources(), download.signature.byte_span(), download.path)) {
+		std::error_code ec;
+		std::filesystem::remove(download.path.getString().cppStr(), ec);
+		Concurrent::execute(Executors::getMainUpdateThread(), [this]()
+		{
+			log(LoggerLevel::Error, "Invalid signature on editor update.");
+		});
+		return false;
 	}
-	setProgress(0, totalSize);
-
-	uint64_t totalExtracted = 0;
-	for (size_t i = 0; i < n; ++i) {
-		const auto name = zip.getFileName(i);
-		auto fileBytes = zip.extractFile(i);
-		if (!fileBytes.empty()) {
-			const auto path = rootPath / name;
-			const auto parentPath = path.parentPath().getString().cppStr();
-			std::error_code ec;
-			std::filesystem::create_directories(parentPath, ec);
-			const bool ok = Path::writeFile(path, fileBytes);
 
-			if (ok) {
-				totalExtracted += zip.getFileSize(i);
-				setProgress(totalExtracted, totalSize);
-			} else {
-				Concurrent::execute(Executors::getMainUpdateThread(), [this, name]()
-				{
-					log(LoggerLevel::Error, "Unable to extract file from zip: " + name);
-				});
-				return false;
-			}
-		}
+	bool ok;
+	{
+		EditorPatch patch(projectPath);
+		ok = patch.load(download.path) && patch.apply();
 	}
 
-	return true;
+	std::error_code ec;
+	std::filesystem::remove(download.path.getString().cppStr(), ec);
+	return ok;
+}
+
+Path LaunchProject::getDataPath() const
+{
+	return parent.getProjectDataFolders().getFolder(projectLocation.path);
+}
+
+Path LaunchProject::getStagingPath() const
+{
+	return getDataPath() / "staging";
+}
+
+bool LaunchProject::commitStaging()
+{
+	// Each file is swapped in whole. If a file is locked (e.g. the editor is running), the caller falls back to
+	// extracting the stored archive, which also fixes up anything that was already moved.
+	return ProjectDataFolders::moveFiles(getStagingPath(), projectLocation.path);
+}
+
+void LaunchProject::removeStaging()
+{
+	std::error_code ec;
+	std::filesystem::remove_all(getStagingPath().getString().cppStr(), ec);
 }
 
 void LaunchProject::launchProject()
@@ -208,6 +328,13 @@ void LaunchProject::launchProject()
 		getWidgetAs<UILabel>("status")->setText(LocalisedString::fromHardcodedString("Launching..."));
 	}
 
+	if (startEditor()) {
+		parent.getHalleyAPI().core->quit(0);
+	}
+}
+
+bool LaunchProject::startEditor()
+{
 	const auto dir = Path(projectLocation.path) / "halley" / "bin";
 	const auto cmd = dir / "halley-editor.exe";
 	const auto params = "--project \"" + projectLocation.path
@@ -215,14 +342,28 @@ void LaunchProject::launchProject()
 		+ (safeMode ? " --dont-load-dll" : "");
 
 	if (Path::exists(cmd) && OS::get().runCommandDetached(cmd.getNativeString() + " " + params, dir.getNativeString(false))) {
-		parent.getHalleyAPI().core->quit(0);
+		return true;
 	} else {
 		loadUIIfNeeded();
 		getWidgetAs<UILabel>("status")->setText(LocalisedString::fromHardcodedString("Launching..."));
 		log(LoggerLevel::Error, "Editor not found at " + cmd.getNativeString());
+		return false;
 	}
 }
 
+std::function<bool(uint64_t, uint64_t)> LaunchProject::makeProgressCallback()
+{
+	return [=, flag = NonOwningAliveFlag(aliveFlag)] (uint64_t cur, uint64_t total) -> bool
+	{
+		if (flag) {
+			setProgress(cur, total);
+			return true;
+		} else {
+			return false;
+		}
+	};
+}
+
 void LaunchProject::setProgress(uint64_t progress, uint64_t total)
 {
 	auto lock = std::unique_lock(progressMutex);
@@ -234,19 +375,71 @@ void LaunchProject::checkForProjectUpdates()
 	loadUIIfNeeded();
 	getWidgetAs<UILabel>("status")->setText(LocalisedString::fromHardcodedString("Checking for updates..."));
 
-	const auto url = projectLocation.params["url"].asString("");
-	const auto project = projectLocation.params["project"].asString("");
-	const auto username = projectLocation.params["username"].asString("");
-	const auto password = projectLocation.params["password"].asString("");
-	parent.getWebClient().updateProjectData(url, project, username, password).then(aliveFlag, Executors::getMainUpdateThread(), [=] (bool ok)
+	updateProjectData().then(aliveFlag, Executors::getMainUpdateThread(), [=] (WebClient::UpdateResult result)
 	{
-		if (!ok) {
+		if (result == WebClient::UpdateResult::Failed) {
 			log(LoggerLevel::Warning, "Failed to update project.");
 		}
 		tryLaunching();
 	});
 }
 
+void LaunchProject::fastLaunch()
+{
+	// Launch straight from the last synced copy, and keep the launcher around until the sync is done.
+	// The sync is deferred, so nothing changes under the editor: what it fetches is applied on the next launch.
+	const auto launchedProperties = LauncherProjectProperties::getProjectProperties(projectLocation);
+	if (!launchedProperties) {
+		// The local copy went away (or became unreadable) since it was checked, so update it before launching
+		checkForProjectUpdates();
+		return;
+	}
+	const auto launchedVersion = launchedProperties->halleyVersion;
+
+	loadUIIfNeeded();
+	setProgress(0, 0);
+	if (!startEditor()) {
+		return;
+	}
+	getWidgetAs<UILabel>("status")->setText(LocalisedString::fromHardcodedString("Editor launched, checking for project updates..."));
+
+	updateProjectData(true).then(aliveFlag, Executors::getMainUpdateThread(), [=] (WebClient::UpdateResult result)
+	{
+		if (result != WebClient::UpdateResult::Updated) {
+			if (result == WebClient::UpdateResult::Failed) {
+				Logger::logWarning("Failed to update project, running from the local copy.");
+			}
+			parent.getHalleyAPI().core->quit(0);
+			return;
+		}
+
+		getWidgetAs<UILabel>("status")->setText(LocalisedString::fromHardcodedString("Project update downloaded"));
+		const auto properties = LauncherProjectProperties::getProjectProperties(ProjectLocation(parent.getWebClient().getPendingUpdatePath(projectLocation.path)));
+		if (properties && properties->halleyVersion != launchedVersion) {
+			log(LoggerLevel::Warning, "The project now requires Halley Editor version " + properties->halleyVersion.toString() + ". Close the editor and launch the project again to update.");
+		} else {
+			log(LoggerLevel::Info, "Newer project data arrived after the editor started. Close the editor and launch the project again to pick it up.");
+		}
+	});
+}
+
+bool LaunchProject::canLaunchWithoutUpdate() const
+{
+	const auto properties = LauncherProjectProperties::getProjectProperties(projectLocation);
+	return properties
+		&& properties->builtVersion == properties->halleyVersion
+		&& Path::exists(Path(projectLocation.path) / "halley" / "bin" / "halley-editor.exe");
+}
+
+Future<WebClient::UpdateResult> LaunchProject::updateProjectData(bool deferred)
+{
+	const auto url = projectLocation.params["url"].asString("");
+	const auto project = projectLocation.params["project"].asString("");
+	const auto username = projectLocation.params["username"].asString("");
+	const auto password = projectLocation.params["password"].asString("");
+	return parent.getWebClient().updateProjectData(url, project, username, password, deferred);
+}
+
 void LaunchProject::log(LoggerLevel level, std::string_view msg)
 {
 	const char* styleNames[] = { "ui_logDevText", "ui_logInfoText", "ui_logWarningText", "ui_logErrorText" };
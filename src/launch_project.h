@@ -3,6 +3,7 @@
 #include <halley.hpp>
 
 #include "launcher_settings.h"
+#include "web_client.h"
 
 class LauncherSettings;
 
@@ -36,13 +37,26 @@ namespace Halley {
         void loadUIIfNeeded();
         void tryLaunching();
         void buildProject(bool clean);
-        void downloadEditor(HalleyVersion version);
-        void installEditor(Bytes data);
-        bool doInstallEditor(Bytes data, const Path& path);
+        void downloadEditor(HalleyVersion version, HalleyVersion installedVersion);
+        void downloadFullEditor(HalleyVersion version);
+        void downloadEditorPatch(HalleyVersion from, HalleyVersion to);
+        void storeEditor(HalleyVersion version, Path archivePath, Bytes sha256, bool installed);
+        void installEditor(Path archivePath);
+        bool doInstallEditor(const Path& archivePath, const Path& projectPath);
+        bool doPatchEditor(const WebClient::DownloadedFile& download, const Path& projectPath);
+        Path getDataPath() const;
+        Path getStagingPath() const;
+        bool commitStaging();
+        void removeStaging();
+        std::function<bool(uint64_t, uint64_t)> makeProgressCallback();
         void launchProject();
+        bool startEditor();
 
         void setProgress(uint64_t progress, uint64_t total);
 
         void checkForProjectUpdates();
+        void fastLaunch();
+        bool canLaunchWithoutUpdate() const;
+        Future<WebClient::UpdateResult> updateProjectData(bool deferred = false);
     };
 }
@@ -1,6 +1,28 @@
 #include "launcher_project_properties.h"
 
+#include <filesystem>
+
+namespace {
+	const std::array<const char*, 6> sourceFiles = {
+		"halley_project/properties.yaml",
+		"halley_project/icon48.png",
+		"halley/include/halley_version.hpp",
+		"halley/include/clean_build_if_older.txt",
+		"halley/bin/halley-editor.exe",
+		"halley/bin/build_version.txt"
+	};
+}
+
 std::optional<LauncherProjectProperties> LauncherProjectProperties::getProjectProperties(const ProjectLocation& project, Resources* resources, VideoAPI* videoAPI)
+{
+	auto result = loadProjectProperties(project, resources && videoAPI);
+	if (result && resources && videoAPI) {
+		result->makeIcon(*resources, *videoAPI);
+	}
+	return result;
+}
+
+std::optional<LauncherProjectProperties> LauncherProjectProperties::loadProjectProperties(const ProjectLocation& project, bool loadIcon)
 {
 	const auto& path = Path(project.path);
 
@@ -11,11 +33,10 @@ std::optional<LauncherProjectProperties> LauncherProjectProperties::getProjectPr
 
 	LauncherProjectProperties result;
 
-	if (resources && videoAPI) {
+	if (loadIcon) {
 		const auto iconBytes = Path::readFile(path / "halley_project" / "icon48.png");
 		if (!iconBytes.empty()) {
-			auto image = std::make_unique<Image>(iconBytes.byte_span());
-			result.icon.setImage(*resources, *videoAPI, std::move(image));
+			result.iconImage = std::make_unique<Image>(iconBytes.byte_span());
 		}
 	}
 
@@ -38,3 +59,35 @@ std::optional<LauncherProjectProperties> LauncherProjectProperties::getProjectPr
 
 	return result;
 }
+
+void LauncherProjectProperties::makeIcon(Resources& resources, VideoAPI& videoAPI)
+{
+	if (iconImage) {
+		icon.setImage(resources, videoAPI, std::move(iconImage));
+	}
+}
+
+gsl::span<const char* const> LauncherProjectProperties::getSourceFiles()
+{
+	return sourceFiles;
+}
+
+Vector<int64_t> LauncherProjectProperties::getSourceStamps(const Path& projectPath)
+{
+	Vector<int64_t> result;
+	result.reserve(sourceFiles.size() * 2);
+	for (const auto* file: sourceFiles) {
+		const auto path = (projectPath / file).getString().cppStr();
+		std::error_code ec;
+		const auto size = std::filesystem::file_size(path, ec);
+		const auto time = ec ? std::filesystem::file_time_type() : std::filesystem::last_write_time(path, ec);
+		if (ec) {
+			result.push_back(-1);
+			result.push_back(-1);
+		} else {
+			result.push_back(static_cast<int64_t>(size));
+			result.push_back(static_cast<int64_t>(time.time_since_epoch().count()));
+		}
+	}
+	return result;
+}
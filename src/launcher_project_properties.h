@@ -13,6 +13,17 @@ public:
     HalleyVersion halleyVersion;
     HalleyVersion builtVersion;
     HalleyVersion cleanBuildIfOlderVersion;
+    std::unique_ptr<Image> iconImage; // Decoded by loadProjectProperties, but not turned into a sprite until makeIcon
 
     static std::optional<LauncherProjectProperties> getProjectProperties(const ProjectLocation& project, Resources* resources = nullptr, VideoAPI* videoAPI = nullptr);
+
+    // Only reads from disk and doesn't touch the video API, so it can run on any thread. Call makeIcon afterwards on the main thread.
+    static std::optional<LauncherProjectProperties> loadProjectProperties(const ProjectLocation& project, bool loadIcon);
+    void makeIcon(Resources& resources, VideoAPI& videoAPI);
+
+    // Every file that loadProjectProperties looks at, relative to the project
+    static gsl::span<const char* const> getSourceFiles();
+
+    // Size and modification time of each source file, or -1 for files which don't exist. The properties can only change if these do.
+    static Vector<int64_t> getSourceStamps(const Path& projectPath);
 };
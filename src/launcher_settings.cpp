@@ -2,6 +2,8 @@
 
 #include <filesystem>
 
+#include "file_downloader.h"
+
 ProjectLocation::ProjectLocation(Path path, ConfigNode params)
 	: path(std::move(path))
 	, params(std::move(params))
@@ -40,12 +42,16 @@ ConfigNode LauncherSettings::save() const
 {
 	ConfigNode::MapType result;
 	result["projects"] = projects;
+	result["downloadConnections"] = downloadConnections;
+	result["fastLaunch"] = fastLaunch;
 	return result;
 }
 
 void LauncherSettings::load(const ConfigNode& node)
 {
 	projects = node["projects"].asVector<ProjectLocation>({});
+	downloadConnections = node["downloadConnections"].asInt(FileDownloader::defaultConnections);
+	fastLaunch = node["fastLaunch"].asBool(true);
 	dirty = false;
 }
 
@@ -131,3 +137,13 @@ void LauncherSettings::bumpProject(const Path& path)
 		dirty = true;
 	}
 }
+
+int LauncherSettings::getDownloadConnections() const
+{
+	return downloadConnections > 0 ? downloadConnections : FileDownloader::defaultConnections;
+}
+
+bool LauncherSettings::isFastLaunchEnabled() const
+{
+	return fastLaunch;
+}
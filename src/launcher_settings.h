@@ -35,7 +35,12 @@ public:
 	bool removeProject(const Path& path);
 	void bumpProject(const Path& path);
 
+	int getDownloadConnections() const;
+	bool isFastLaunchEnabled() const;
+
 private:
 	mutable bool dirty = false;
 	Vector<ProjectLocation> projects;
+	int downloadConnections = 0;
+	bool fastLaunch = true;
 };
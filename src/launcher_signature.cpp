@@ -0,0 +1,19 @@
+#include "launcher_signature.h"
+
+#include "mapped_file.h"
+
+bool LauncherSignature::verifyFile(Resources& resources, gsl::span<const gsl::byte> signature, const Path& path)
+{
+	if (signature.empty()) {
+		return false;
+	}
+
+	MappedFile file;
+	if (!file.open(path)) {
+		Logger::logError("Unable to read " + path.getNativeString(false) + " to verify it.");
+		return false;
+	}
+
+	const auto publicKey = resources.get<BinaryFile>("binary/halley-launcher.pub");
+	return Cryptography::verifySignature(Cryptography::HashAlgorithm::SHA256, publicKey->getSpan(), signature, file.getSpan());
+}
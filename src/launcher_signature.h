@@ -0,0 +1,12 @@
+#pragma once
+
+#include <halley.hpp>
+using namespace Halley;
+
+// Verifies files published on the update server against the launcher's public key.
+// Cryptography::verifySignature only takes the signed data, not a digest, so the SHA-256 computed while downloading can't be
+// used here and the file is read again to check it. It's mapped rather than loaded, so large downloads aren't held in memory.
+class LauncherSignature {
+public:
+	static bool verifyFile(Resources& resources, gsl::span<const gsl::byte> signature, const Path& path);
+};
@@ -1,5 +1,7 @@
 #include "launcher_stage.h"
 
+#include <ctime>
+
 #include "choose_project.h"
 #include "launcher.h"
 #include "launcher_save_data.h"
@@ -15,9 +17,14 @@ LauncherStage::LauncherStage(std::optional<String> initialProject)
 
 void LauncherStage::init()
 {
-	auto webProjectsPath = getCoreAPI().getEnvironment().getDataPath() / "web_projects";
-	webClient = std::make_unique<WebClient>(getWebAPI(), getSettings(), webProjectsPath);
+	const auto dataPath = getCoreAPI().getEnvironment().getDataPath();
+	sessionTokens = std::make_unique<SessionTokenCache>(dataPath / "session_tokens");
+	projectDataFolders = std::make_unique<ProjectDataFolders>(dataPath / "project_data");
+	webClient = std::make_unique<WebClient>(getWebAPI(), getSettings(), *sessionTokens, *projectDataFolders, dataPath / "web_projects", dataPath / "downloads");
+	editorStore = std::make_shared<EditorStore>(dataPath / "editor_store");
+	projectPropertiesCache = std::make_shared<ProjectPropertiesCache>(dataPath / "project_properties");
 	saveData = std::make_shared<LauncherSaveData>(getSystemAPI().getStorageContainer(SaveDataType::SaveLocal));
+	collectEditorGarbage();
 	
 	makeUI();
 	makeSprites();
@@ -34,6 +41,28 @@ void LauncherStage::init()
 	});
 }
 
+void LauncherStage::collectEditorGarbage()
+{
+	const auto& projects = getSettings().getProjects();
+	Concurrent::execute([editorStore = editorStore, cache = projectPropertiesCache, projects = Vector<ProjectLocation>(projects.begin(), projects.end())] ()
+	{
+		// Anything used from now on might be for a project this scan can't see, such as one just added by another launcher
+		const auto usedSince = static_cast<int64_t>(std::time(nullptr));
+
+		// If any project can't be read right now, it's not known which editors are unused, so nothing is removed
+		std::optional<Vector<HalleyVersion>> versionsInUse = Vector<HalleyVersion>();
+		for (const auto& project: projects) {
+			if (const auto properties = cache->get(project, false)) {
+				versionsInUse->push_back(properties->halleyVersion);
+			} else {
+				versionsInUse = std::nullopt;
+				break;
+			}
+		}
+		editorStore->collectGarbage(versionsInUse, usedSince);
+	});
+}
+
 void LauncherStage::onVariableUpdate(Time time)
 {
 	mainThreadExecutor.runPending();
@@ -49,6 +78,9 @@ void LauncherStage::onVariableUpdate(Time time)
 	if (settings.isDirty()) {
 		settings.saveToFile(getSystemAPI());
 	}
+	if (projectPropertiesCache->isDirty()) {
+		projectPropertiesCache->save(settings.getProjects());
+	}
 }
 
 void LauncherStage::onRender(RenderContext& context) const
@@ -109,6 +141,21 @@ WebClient& LauncherStage::getWebClient()
 	return *webClient;
 }
 
+std::shared_ptr<EditorStore> LauncherStage::getEditorStore()
+{
+	return editorStore;
+}
+
+std::shared_ptr<ProjectPropertiesCache> LauncherStage::getProjectPropertiesCache()
+{
+	return projectPropertiesCache;
+}
+
+const ProjectDataFolders& LauncherStage::getProjectDataFolders() const
+{
+	return *projectDataFolders;
+}
+
 LauncherSettings& LauncherStage::getSettings()
 {
 	return dynamic_cast<HalleyLauncher&>(getGame()).getSettings();
@@ -2,8 +2,12 @@
 
 #include <halley.hpp>
 
+#include "editor_store.h"
 #include "launcher_save_data.h"
 #include "new_version_info.h"
+#include "project_data_folders.h"
+#include "project_properties_cache.h"
+#include "session_token_cache.h"
 #include "web_client.h"
 
 class LauncherSettings;
@@ -18,6 +22,9 @@ namespace Halley {
 		virtual std::optional<NewVersionInfo> getNewVersionInfo() const = 0;
 		virtual void exit() = 0;
 		virtual WebClient& getWebClient() = 0;
+		virtual std::shared_ptr<EditorStore> getEditorStore() = 0;
+		virtual std::shared_ptr<ProjectPropertiesCache> getProjectPropertiesCache() = 0;
+		virtual const ProjectDataFolders& getProjectDataFolders() const = 0;
 		virtual LauncherSettings& getSettings() = 0;
 	};
 
@@ -38,6 +45,9 @@ namespace Halley {
 		void exit() override;
 
 		WebClient& getWebClient() override;
+		std::shared_ptr<EditorStore> getEditorStore() override;
+		std::shared_ptr<ProjectPropertiesCache> getProjectPropertiesCache() override;
+		const ProjectDataFolders& getProjectDataFolders() const override;
 		LauncherSettings& getSettings() override;
 
 	private:
@@ -48,7 +58,11 @@ namespace Halley {
 		std::shared_ptr<UIWidget> topLevelUI;
 		std::shared_ptr<UIWidget> curUI;
 
+		std::unique_ptr<SessionTokenCache> sessionTokens;
+		std::unique_ptr<ProjectDataFolders> projectDataFolders;
 		std::unique_ptr<WebClient> webClient;
+		std::shared_ptr<EditorStore> editorStore;
+		std::shared_ptr<ProjectPropertiesCache> projectPropertiesCache;
 
 		Executor mainThreadExecutor;
 
@@ -58,6 +72,7 @@ namespace Halley {
 		Future<NewVersionInfo> newVersionCheck;
 		std::optional<NewVersionInfo> newVersionInfo;
 
+		void collectEditorGarbage();
 		void makeSprites();
 		void makeUI();
 		void updateUI(Time time);
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <halley.hpp>
+using namespace Halley;
+
+// Read-only memory mapping of a whole file. Pages are only read from disk when they're first touched,
+// so a large file can be accessed at random without loading it, and without going through a file stream.
+class MappedFile {
+public:
+	MappedFile() = default;
+	~MappedFile();
+
+	MappedFile(const MappedFile& other) = delete;
+	MappedFile& operator=(const MappedFile& other) = delete;
+
+	bool open(const Path& path);
+	void close();
+
+	bool isOpen() const;
+	gsl::span<const gsl::byte> getSpan() const;
+
+private:
+	const gsl::byte* data = nullptr;
+	size_t size = 0;
+};
@@ -0,0 +1,61 @@
+#include "project_data_folders.h"
+
+#include <filesystem>
+
+namespace {
+	void moveFile(const std::filesystem::path& src, const std::filesystem::path& dst, std::error_code& ec)
+	{
+		std::filesystem::rename(src, dst, ec);
+		if (ec == std::errc::cross_device_link) {
+			auto tmp = dst;
+			tmp += ".launcher_tmp";
+			if (std::filesystem::copy_file(src, tmp, std::filesystem::copy_options::overwrite_existing, ec)) {
+				std::filesystem::rename(tmp, dst, ec);
+				if (!ec) {
+					std::filesystem::remove(src, ec);
+				}
+			}
+		}
+	}
+}
+
+ProjectDataFolders::ProjectDataFolders(Path rootPath)
+	: rootPath(std::move(rootPath))
+{
+}
+
+Path ProjectDataFolders::getFolder(const Path& projectPath) const
+{
+	Hash::Hasher hasher;
+	hasher.feed(projectPath.getString());
+	return rootPath / (projectPath.getFilename().getString() + "-" + toString(hasher.digest(), 16));
+}
+
+bool ProjectDataFolders::moveFiles(const Path& src, const Path& dst)
+{
+	const auto srcPath = src.getString().cppStr();
+	const auto dstPath = std::filesystem::path(dst.getString().cppStr());
+	std::error_code ec;
+	if (!std::filesystem::exists(srcPath, ec)) {
+		return true;
+	}
+	for (auto iter = std::filesystem::recursive_directory_iterator(srcPath, ec); !ec && iter != std::filesystem::recursive_directory_iterator(); iter.increment(ec)) {
+		if (!iter->is_regular_file(ec)) {
+			continue;
+		}
+		const auto target = dstPath / std::filesystem::relative(iter->path(), srcPath, ec);
+		if (ec) {
+			break;
+		}
+		std::filesystem::create_directories(target.parent_path(), ec);
+		if (ec) {
+			break;
+		}
+		moveFile(iter->path(), target, ec);
+		if (ec) {
+			Logger::logWarning("Unable to move " + String(target.string()) + " into place: " + String(ec.message()));
+			break;
+		}
+	}
+	return !ec;
+}
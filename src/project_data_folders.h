@@ -0,0 +1,22 @@
+#pragma once
+
+#include <halley.hpp>
+using namespace Halley;
+
+// Files the launcher keeps about each project (sync manifest, extraction index, staging area) live in the launcher's data
+// folder rather than in the project, so they never end up in the project's version control or in front of its tools.
+// Each project gets its own folder, keyed by a hash of its path.
+class ProjectDataFolders {
+public:
+	ProjectDataFolders(Path rootPath);
+
+	Path getFolder(const Path& projectPath) const;
+
+	// Moves every file under src to the same place under dst, replacing what's there, by a rename if possible.
+	// The data folder can be on another volume, in which case each file is copied next to its destination and swapped in whole.
+	// Stops at the first file that can't be moved (e.g. because it's locked), leaving it and the rest in src.
+	static bool moveFiles(const Path& src, const Path& dst);
+
+private:
+	Path rootPath;
+};
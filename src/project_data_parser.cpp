@@ -0,0 +1,338 @@
+#include "project_data_parser.h"
+
+#include <filesystem>
+
+#include "zip_reader.h"
+
+namespace {
+	bool isWhitespace(char c)
+	{
+		return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+	}
+
+	int getBase64Value(char c)
+	{
+		if (c >= 'A' && c <= 'Z') {
+			return c - 'A';
+		} else if (c >= 'a' && c <= 'z') {
+			return c - 'a' + 26;
+		} else if (c >= '0' && c <= '9') {
+			return c - '0' + 52;
+		} else if (c == '+' || c == '-') {
+			return 62;
+		} else if (c == '/' || c == '_') {
+			return 63;
+		}
+		return -1;
+	}
+}
+
+ProjectDataParser::ProjectDataParser(Path basePath)
+	: basePath(std::move(basePath))
+{
+}
+
+bool ProjectDataParser::feed(gsl::span<const gsl::byte> data)
+{
+	for (const auto b: data) {
+		if (!processChar(static_cast<char>(b))) {
+			state = State::Error;
+			return false;
+		}
+	}
+	return true;
+}
+
+bool ProjectDataParser::finish()
+{
+	if (state == State::Literal) {
+		onValueEnd();
+	}
+	return state == State::Done && !fileFailed;
+}
+
+size_t ProjectDataParser::getNumFilesWritten() const
+{
+	return numFilesWritten;
+}
+
+bool ProjectDataParser::processChar(char c)
+{
+	switch (state) {
+	case State::Value:
+		return isWhitespace(c) || onValueStart(c);
+
+	case State::ValueOrEnd:
+		if (isWhitespace(c)) {
+			return true;
+		} else if (c == ']') {
+			return onContainerEnd(c);
+		}
+		return onValueStart(c);
+
+	case State::KeyOrEnd:
+	case State::Key:
+		if (isWhitespace(c)) {
+			return true;
+		} else if (c == '}' && state == State::KeyOrEnd) {
+			return onContainerEnd(c);
+		} else if (c == '"') {
+			stringTarget = StringTarget::Key;
+			stringValue.clear();
+			state = State::String;
+			return true;
+		}
+		return false;
+
+	case State::Colon:
+		if (isWhitespace(c)) {
+			return true;
+		} else if (c == ':') {
+			state = State::Value;
+			return true;
+		}
+		return false;
+
+	case State::AfterValue:
+		if (isWhitespace(c)) {
+			return true;
+		} else if (c == ',' && !stack.empty()) {
+			state = stack.back().isObject ? State::Key : State::Value;
+			return true;
+		} else if (c == '}' || c == ']') {
+			return onContainerEnd(c);
+		}
+		return false;
+
+	case State::String:
+		if (c == '"') {
+			onStringEnd();
+		} else if (c == '\\') {
+			state = State::StringEscape;
+		} else {
+			onStringChar(c);
+		}
+		return true;
+
+	case State::StringEscape:
+		state = State::String;
+		switch (c) {
+		case 'n': onStringChar('\n'); return true;
+		case 't': onStringChar('\t'); return true;
+		case 'r': onStringChar('\r'); return true;
+		case 'b': onStringChar('\b'); return true;
+		case 'f': onStringChar('\f'); return true;
+		case 'u':
+			unicodeValue = 0;
+			unicodeDigits = 0;
+			state = State::StringUnicode;
+			return true;
+		default:
+			onStringChar(c);
+			return true;
+		}
+
+	case State::StringUnicode:
+		{
+			const int digit = (c >= '0' && c <= '9') ? c - '0' : (c >= 'a' && c <= 'f') ? c - 'a' + 10 : (c >= 'A' && c <= 'F') ? c - 'A' + 10 : -1;
+			if (digit < 0) {
+				return false;
+			}
+			unicodeValue = (unicodeValue << 4) | static_cast<uint32_t>(digit);
+			if (++unicodeDigits == 4) {
+				state = State::String;
+				if (unicodeValue < 0x80) {
+					onStringChar(static_cast<char>(unicodeValue));
+				} else if (unicodeValue < 0x800) {
+					onStringChar(static_cast<char>(0xC0 | (unicodeValue >> 6)));
+					onStringChar(static_cast<char>(0x80 | (unicodeValue & 0x3F)));
+				} else {
+					onStringChar(static_cast<char>(0xE0 | (unicodeValue >> 12)));
+					onStringChar(static_cast<char>(0x80 | ((unicodeValue >> 6) & 0x3F)));
+					onStringChar(static_cast<char>(0x80 | (unicodeValue & 0x3F)));
+				}
+			}
+			return true;
+		}
+
+	case State::Literal:
+		if (c == ',' || c == '}' || c == ']' || isWhitespace(c)) {
+			onValueEnd();
+			return processChar(c);
+		}
+		return true;
+
+	case State::Done:
+		return isWhitespace(c);
+
+	case State::Error:
+		return false;
+	}
+
+	return false;
+}
+
+bool ProjectDataParser::onValueStart(char c)
+{
+	if (c == '{' || c == '[') {
+		stack.push_back(Container{ c == '{', "" });
+		state = c == '{' ? State::KeyOrEnd : State::ValueOrEnd;
+		if (isInFileEntry()) {
+			startEntry();
+		}
+		return true;
+	} else if (c == '"') {
+		stringTarget = StringTarget::Ignore;
+		if (isInFileEntry()) {
+			const auto& key = stack.back().key;
+			if (key == "path") {
+				stringTarget = StringTarget::Path;
+				stringValue.clear();
+			} else if (key == "bytes") {
+				stringTarget = StringTarget::Bytes;
+				base64Accumulator = 0;
+				base64Bits = 0;
+			}
+		}
+		state = State::String;
+		return true;
+	} else if (c == '-' || (c >= '0' && c <= '9') || c == 't' || c == 'f' || c == 'n') {
+		state = State::Literal;
+		return true;
+	}
+	return false;
+}
+
+void ProjectDataParser::onValueEnd()
+{
+	state = stack.empty() ? State::Done : State::AfterValue;
+}
+
+void ProjectDataParser::onStringChar(char c)
+{
+	switch (stringTarget) {
+	case StringTarget::Key:
+	case StringTarget::Path:
+		stringValue.push_back(c);
+		break;
+	case StringTarget::Bytes:
+		decodeBase64(c);
+		break;
+	case StringTarget::Ignore:
+		break;
+	}
+}
+
+void ProjectDataParser::onStringEnd()
+{
+	if (stringTarget == StringTarget::Key) {
+		stack.back().key = stringValue;
+		state = State::Colon;
+		return;
+	}
+
+	if (stringTarget == StringTarget::Path) {
+		filePath = stringValue;
+		if (!fileData.empty()) {
+			flushFile();
+		}
+	} else if (stringTarget == StringTarget::Bytes) {
+		flushFile();
+	}
+	onValueEnd();
+}
+
+bool ProjectDataParser::onContainerEnd(char c)
+{
+	if (stack.empty() || stack.back().isObject != (c == '}')) {
+		return false;
+	}
+
+	if (isInFileEntry()) {
+		endEntry();
+	}
+	stack.pop_back();
+	onValueEnd();
+	return true;
+}
+
+bool ProjectDataParser::isInFileEntry() const
+{
+	return stack.size() == 3 && stack[0].isObject && stack[0].key == "files" && !stack[1].isObject && stack[2].isObject;
+}
+
+void ProjectDataParser::startEntry()
+{
+	filePath = "";
+	fileData.clear();
+	file.clear();
+}
+
+void ProjectDataParser::endEntry()
+{
+	flushFile();
+	if (file.is_open()) {
+		file.close();
+		if (file) {
+			++numFilesWritten;
+		} else {
+			fileFailed = true;
+		}
+	}
+	filePath = "";
+	fileData.clear();
+}
+
+void ProjectDataParser::decodeBase64(char c)
+{
+	const int value = getBase64Value(c);
+	if (value < 0) {
+		// Padding or line breaks
+		return;
+	}
+
+	base64Accumulator = (base64Accumulator << 6) | static_cast<uint32_t>(value);
+	base64Bits += 6;
+	if (base64Bits >= 8) {
+		base64Bits -= 8;
+		fileData.push_back(static_cast<gsl::byte>((base64Accumulator >> base64Bits) & 0xFF));
+	}
+
+	if (fileData.size() >= flushSize && !filePath.isEmpty()) {
+		flushFile();
+	}
+}
+
+void ProjectDataParser::flushFile()
+{
+	if (fileData.empty() || filePath.isEmpty()) {
+		return;
+	}
+
+	if (!file.is_open() && !openFile()) {
+		fileData.clear();
+		return;
+	}
+
+	file.write(reinterpret_cast<const char*>(fileData.data()), static_cast<std::streamsize>(fileData.size()));
+	fileData.clear();
+}
+
+bool ProjectDataParser::openFile()
+{
+	if (!ZipReader::isSafeName(filePath)) {
+		Logger::logWarning("Skipping unsafe path \"" + filePath + "\" in project data");
+		return false;
+	}
+
+	const auto path = basePath / filePath;
+	std::error_code ec;
+	std::filesystem::create_directories(path.parentPath().getString().cppStr(), ec);
+	file.open(path.getString().cppStr(), std::ios::binary | std::ios::trunc);
+	if (!file) {
+		Logger::logError("Could not write to " + path.getNativeString(false));
+		fileFailed = true;
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <halley.hpp>
+
+#include <fstream>
+using namespace Halley;
+
+// Streaming parser for the external-project-properties payload: { "files": [ { "path": ..., "bytes": <base64> }, ... ] }
+// Fed the response as it downloads. Each file is base64-decoded as it's parsed and written straight to disk, so memory use is
+// bounded by the largest file (or less, if "path" comes before "bytes"), instead of the whole project.
+class ProjectDataParser {
+public:
+	ProjectDataParser(Path basePath);
+
+	bool feed(gsl::span<const gsl::byte> data);
+	bool finish();
+
+	size_t getNumFilesWritten() const;
+
+private:
+	enum class State {
+		Value,
+		ValueOrEnd,
+		KeyOrEnd,
+		Key,
+		Colon,
+		AfterValue,
+		String,
+		StringEscape,
+		StringUnicode,
+		Literal,
+		Done,
+		Error
+	};
+
+	enum class StringTarget {
+		Key,
+		Path,
+		Bytes,
+		Ignore
+	};
+
+	struct Container {
+		bool isObject;
+		String key;
+	};
+
+	constexpr static size_t flushSize = 64 * 1024;
+
+	Path basePath;
+	State state = State::Value;
+	Vector<Container> stack;
+
+	StringTarget stringTarget = StringTarget::Ignore;
+	std::string stringValue;
+	uint32_t unicodeValue = 0;
+	int unicodeDigits = 0;
+
+	String filePath;
+	Bytes fileData;
+	std::ofstream file;
+	bool fileFailed = false;
+	uint32_t base64Accumulator = 0;
+	int base64Bits = 0;
+	size_t numFilesWritten = 0;
+
+	bool processChar(char c);
+	bool onValueStart(char c);
+	void onValueEnd();
+	void onStringChar(char c);
+	void onStringEnd();
+	bool onContainerEnd(char c);
+
+	bool isInFileEntry() const;
+	void startEntry();
+	void endEntry();
+	void decodeBase64(char c);
+	void flushFile();
+	bool openFile();
+};
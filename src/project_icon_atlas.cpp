@@ -0,0 +1,129 @@
+#include "project_icon_atlas.h"
+
+ProjectIconAtlas::ProjectIconAtlas(Resources& resources, VideoAPI& videoAPI)
+	: resources(resources)
+	, videoAPI(videoAPI)
+	, pixels(std::make_unique<Image>(Image::Format::RGBA, Vector2i(initialSize, initialSize)))
+{
+}
+
+bool ProjectIconAtlas::add(const String& id, const Image& icon)
+{
+	if (icon.getFormat() != Image::Format::RGBA || icon.getSize() != Vector2i(iconSize, iconSize)) {
+		return false;
+	}
+
+	int slot;
+	if (const auto iter = slots.find(id); iter != slots.end()) {
+		slot = iter->second;
+	} else if (const auto newSlot = allocateSlot()) {
+		slot = *newSlot;
+		slots[id] = slot;
+	} else {
+		return false;
+	}
+
+	blit(*pixels, getSlotPosition(slot, size), icon, Vector2i(), icon.getSize());
+	dirty = true;
+	return true;
+}
+
+void ProjectIconAtlas::remove(const String& id)
+{
+	// The old pixels are left in place, as nothing draws them anymore
+	if (const auto iter = slots.find(id); iter != slots.end()) {
+		freeSlots.push_back(iter->second);
+		slots.erase(iter);
+	}
+}
+
+bool ProjectIconAtlas::flush()
+{
+	if (!dirty) {
+		return false;
+	}
+	dirty = false;
+
+	// setImage takes ownership, so it gets a copy and the CPU side stays available for the next icons
+	auto image = std::make_unique<Image>(Image::Format::RGBA, pixels->getSize(), false);
+	blit(*image, Vector2i(), *pixels, Vector2i(), pixels->getSize());
+	sprite = Sprite().setImage(resources, videoAPI, std::move(image));
+	return true;
+}
+
+std::optional<Sprite> ProjectIconAtlas::getSprite(const String& id) const
+{
+	const auto iter = slots.find(id);
+	if (iter == slots.end() || !sprite.hasMaterial()) {
+		return std::nullopt;
+	}
+
+	const auto pos = Vector2f(getSlotPosition(iter->second, size));
+	const auto atlasSize = Vector2f(pixels->getSize());
+	auto result = sprite;
+	result
+		.setTexRect(Rect4f(pos / atlasSize, (pos + Vector2f(iconSize, iconSize)) / atlasSize))
+		.setSize(Vector2f(iconSize, iconSize));
+	return result;
+}
+
+int ProjectIconAtlas::getCapacity(int atlasSize) const
+{
+	const auto columns = atlasSize / (iconSize + 2 * padding);
+	return columns * columns;
+}
+
+Vector2i ProjectIconAtlas::getSlotPosition(int slot, int atlasSize) const
+{
+	// Each slot has a transparent border, so filtering doesn't bleed the neighbouring icons in
+	const auto cellSize = iconSize + 2 * padding;
+	const auto columns = atlasSize / cellSize;
+	return Vector2i(slot % columns, slot / columns) * cellSize + Vector2i(padding, padding);
+}
+
+std::optional<int> ProjectIconAtlas::allocateSlot()
+{
+	if (!freeSlots.empty()) {
+		const auto slot = freeSlots.back();
+		freeSlots.pop_back();
+		return slot;
+	}
+
+	if (numSlots == getCapacity(size)) {
+		if (size >= maxSize) {
+			return std::nullopt;
+		}
+		grow();
+	}
+	return numSlots++;
+}
+
+void ProjectIconAtlas::grow()
+{
+	// The number of columns changes, so every icon moves to its slot's new position
+	const auto newSize = size * 2;
+	auto newPixels = std::make_unique<Image>(Image::Format::RGBA, Vector2i(newSize, newSize));
+	for (const auto& [id, slot]: slots) {
+		blit(*newPixels, getSlotPosition(slot, newSize), *pixels, getSlotPosition(slot, size), Vector2i(iconSize, iconSize));
+	}
+
+	pixels = std::move(newPixels);
+	size = newSize;
+	dirty = true;
+}
+
+void ProjectIconAtlas::blit(Image& dst, Vector2i dstPos, const Image& src, Vector2i srcPos, Vector2i srcSize)
+{
+	constexpr size_t bytesPerPixel = 4;
+	const auto dstBytes = dst.getPixelBytes();
+	const auto srcBytes = src.getPixelBytes();
+	const auto dstStride = static_cast<size_t>(dst.getSize().x) * bytesPerPixel;
+	const auto srcStride = static_cast<size_t>(src.getSize().x) * bytesPerPixel;
+	const auto rowSize = static_cast<size_t>(srcSize.x) * bytesPerPixel;
+
+	for (int y = 0; y < srcSize.y; ++y) {
+		auto* dstRow = dstBytes.data() + static_cast<size_t>(dstPos.y + y) * dstStride + static_cast<size_t>(dstPos.x) * bytesPerPixel;
+		const auto* srcRow = srcBytes.data() + static_cast<size_t>(srcPos.y + y) * srcStride + static_cast<size_t>(srcPos.x) * bytesPerPixel;
+		memcpy(dstRow, srcRow, rowSize);
+	}
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <halley.hpp>
+using namespace Halley;
+
+// Packs project icons into one shared texture, so a whole list of projects draws with a single material.
+// Textures can't be updated in place, so the pixels are kept on the CPU too, and the texture is rebuilt by flush() after any number of
+// icons were added. The atlas doubles in size when it runs out of room, and slots of removed icons are given to new ones.
+class ProjectIconAtlas {
+public:
+	constexpr static int iconSize = 48;
+	constexpr static int padding = 1;
+	constexpr static int initialSize = 256;
+	constexpr static int maxSize = 2048;
+
+	ProjectIconAtlas(Resources& resources, VideoAPI& videoAPI);
+
+	// Returns false if the icon can't go in the atlas (not 48x48 RGBA, or the atlas is full), in which case it needs its own texture
+	bool add(const String& id, const Image& icon);
+	void remove(const String& id);
+
+	// Rebuilds the texture if icons were added since the last flush. Returns true if that happened, as any sprites taken from the atlas
+	// before then no longer show the new icons, and should be replaced with new ones from getSprite.
+	bool flush();
+
+	std::optional<Sprite> getSprite(const String& id) const;
+
+private:
+	Resources& resources;
+	VideoAPI& videoAPI;
+
+	int size = initialSize;
+	std::unique_ptr<Image> pixels;
+	Sprite sprite;
+	bool dirty = false;
+
+	HashMap<String, int> slots;
+	Vector<int> freeSlots;
+	int numSlots = 0;
+
+	int getCapacity(int atlasSize) const;
+	Vector2i getSlotPosition(int slot, int atlasSize) const;
+	std::optional<int> allocateSlot();
+	void grow();
+
+	static void blit(Image& dst, Vector2i dstPos, const Image& src, Vector2i srcPos, Vector2i srcSize);
+};
@@ -0,0 +1,149 @@
+#include "project_properties_cache.h"
+
+#include <set>
+
+ProjectPropertiesCache::ProjectPropertiesCache(Path filePath)
+	: filePath(std::move(filePath))
+{
+}
+
+std::optional<LauncherProjectProperties> ProjectPropertiesCache::get(const ProjectLocation& project, bool loadIcon)
+{
+	const auto path = Path(project.path);
+	const auto key = path.getString();
+	const auto stamps = LauncherProjectProperties::getSourceStamps(path);
+
+	{
+		auto lock = std::unique_lock(mutex);
+		load();
+		if (entries.hasKey(key) && isValid(entries[key], stamps, loadIcon)) {
+			return fromConfigNode(entries[key], path, loadIcon);
+		}
+	}
+
+	auto result = LauncherProjectProperties::loadProjectProperties(project, loadIcon);
+
+	auto lock = std::unique_lock(mutex);
+	if (result) {
+		entries[key] = toConfigNode(*result, stamps, loadIcon);
+	} else if (entries.hasKey(key)) {
+		entries.removeKey(key);
+	}
+	dirty = true;
+	return result;
+}
+
+bool ProjectPropertiesCache::isDirty() const
+{
+	auto lock = std::unique_lock(mutex);
+	return dirty;
+}
+
+void ProjectPropertiesCache::save(gsl::span<const ProjectLocation> projects)
+{
+	auto lock = std::unique_lock(mutex);
+	load();
+
+	// Drop projects which have been removed from the launcher since they were cached
+	std::set<String> keys;
+	for (const auto& project: projects) {
+		keys.insert(Path(project.path).getString());
+	}
+	Vector<String> toRemove;
+	for (const auto& [key, entry]: entries.asMap()) {
+		if (keys.find(key) == keys.end()) {
+			toRemove.push_back(key);
+		}
+	}
+	for (const auto& key: toRemove) {
+		entries.removeKey(key);
+	}
+
+	ConfigFile file;
+	file.getRoot() = ConfigNode(entries);
+	Path::writeFile(filePath, Serializer::toBytes(file));
+	dirty = false;
+}
+
+void ProjectPropertiesCache::load()
+{
+	if (!loaded) {
+		loaded = true;
+		const auto bytes = Path::readFile(filePath);
+		if (!bytes.empty()) {
+			entries = ConfigNode(Deserializer::fromBytes<ConfigFile>(bytes).getRoot());
+		}
+		if (entries.getType() != ConfigNodeType::Map) {
+			entries = ConfigNode::MapType();
+		}
+	}
+}
+
+bool ProjectPropertiesCache::isValid(const ConfigNode& entry, const Vector<int64_t>& stamps, bool loadIcon)
+{
+	if (entry.getType() != ConfigNodeType::Map || (loadIcon && !entry["iconLoaded"].asBool(false))) {
+		return false;
+	}
+
+	const auto& cachedStamps = entry["stamps"];
+	if (cachedStamps.getType() != ConfigNodeType::Sequence || cachedStamps.asSequence().size() != stamps.size()) {
+		return false;
+	}
+	for (size_t i = 0; i < stamps.size(); ++i) {
+		if (cachedStamps.asSequence()[i].asInt64(-2) != stamps[i]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+ConfigNode ProjectPropertiesCache::toConfigNode(const LauncherProjectProperties& properties, const Vector<int64_t>& stamps, bool loadIcon)
+{
+	ConfigNode::MapType result;
+
+	ConfigNode::SequenceType stampNodes;
+	for (const auto stamp: stamps) {
+		stampNodes.push_back(ConfigNode(stamp));
+	}
+	result["stamps"] = std::move(stampNodes);
+
+	result["name"] = properties.name;
+	result["halleyVersion"] = properties.halleyVersion.toString();
+	result["builtVersion"] = properties.builtVersion.toString();
+	result["cleanBuildIfOlderVersion"] = properties.cleanBuildIfOlderVersion.toString();
+
+	// The icon is stored already decoded, so it can go straight to the GPU
+	result["iconLoaded"] = loadIcon;
+	if (properties.iconImage) {
+		const auto pixels = properties.iconImage->getPixelBytes();
+		Bytes iconBytes(pixels.size());
+		memcpy(iconBytes.data(), pixels.data(), pixels.size());
+		result["iconFormat"] = static_cast<int>(properties.iconImage->getFormat());
+		result["iconSize"] = properties.iconImage->getSize();
+		result["icon"] = ConfigNode(std::move(iconBytes));
+	}
+
+	return result;
+}
+
+LauncherProjectProperties ProjectPropertiesCache::fromConfigNode(const ConfigNode& entry, const Path& projectPath, bool loadIcon)
+{
+	LauncherProjectProperties result;
+	result.path = projectPath;
+	result.name = entry["name"].asString("Unknown");
+	result.halleyVersion.parse(entry["halleyVersion"].asString("0.0.0"));
+	result.builtVersion.parse(entry["builtVersion"].asString("0.0.0"));
+	result.cleanBuildIfOlderVersion.parse(entry["cleanBuildIfOlderVersion"].asString("0.0.0"));
+
+	if (loadIcon && entry.hasKey("icon")) {
+		const auto& iconBytes = entry["icon"].asBytes();
+		auto image = std::make_unique<Image>(static_cast<Image::Format>(entry["iconFormat"].asInt()), entry["iconSize"].asVector2i(), false);
+		const auto pixels = image->getPixelBytes();
+		if (pixels.size() == iconBytes.size()) {
+			memcpy(pixels.data(), iconBytes.data(), pixels.size());
+			result.iconImage = std::move(image);
+		}
+	}
+
+	return result;
+}
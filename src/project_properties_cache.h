@@ -0,0 +1,34 @@
+#pragma once
+
+#include <halley.hpp>
+
+#include "launcher_project_properties.h"
+using namespace Halley;
+
+// Remembers what was read from each project (name, versions and decoded icon), keyed by project path, so listing projects
+// only needs to check the files' sizes and modification times instead of reading and parsing them again.
+// An entry is only used while every file it was read from is unchanged; otherwise the project is read again and the entry replaced.
+class ProjectPropertiesCache {
+public:
+	ProjectPropertiesCache(Path filePath);
+
+	// Safe to call from any thread, like LauncherProjectProperties::loadProjectProperties. Call makeIcon on the result afterwards.
+	std::optional<LauncherProjectProperties> get(const ProjectLocation& project, bool loadIcon);
+
+	bool isDirty() const;
+	// Only the given projects are kept, so entries for projects removed from the launcher don't pile up
+	void save(gsl::span<const ProjectLocation> projects);
+
+private:
+	Path filePath;
+	mutable std::mutex mutex;
+	ConfigNode entries;
+	bool loaded = false;
+	bool dirty = false;
+
+	void load();
+
+	static bool isValid(const ConfigNode& entry, const Vector<int64_t>& stamps, bool loadIcon);
+	static ConfigNode toConfigNode(const LauncherProjectProperties& properties, const Vector<int64_t>& stamps, bool loadIcon);
+	static LauncherProjectProperties fromConfigNode(const ConfigNode& entry, const Path& projectPath, bool loadIcon);
+};
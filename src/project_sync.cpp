@@ -0,0 +1,314 @@
+#include "project_sync.h"
+
+#include <filesystem>
+
+#include "file_writer.h"
+#include "gzip_decoder.h"
+#include "project_data_folders.h"
+#include "sha256.h"
+#include "zip_reader.h"
+
+ProjectSync::ProjectSync(WebAPI& webAPI, String baseURL, String project, String token, Path localPath, Path manifestPath, std::optional<Path> pendingPath)
+	: webAPI(webAPI)
+	, baseURL(std::move(baseURL))
+	, project(std::move(project))
+	, token(std::move(token))
+	, localPath(std::move(localPath))
+	, manifestPath(std::move(manifestPath))
+	, pendingPath(std::move(pendingPath))
+{
+}
+
+Future<ProjectSync::Result> ProjectSync::run()
+{
+	auto result = promise.getFuture();
+
+	const auto url = baseURL + "/external-project-manifest/" + Encode::encodeURL(project);
+	auto request = webAPI.makeHTTPRequest(HTTPMethod::GET, url);
+	request->setHeader("Authorization", "Bearer " + token);
+	request->setHeader("Accept-Encoding", "gzip");
+	request->send().then([this, self = shared_from_this()] (std::unique_ptr<HTTPResponse> response)
+	{
+		const auto code = response->getResponseCode();
+		auto manifest = code == 200 ? GZipDecoder::decodeIfCompressed(response->moveBody()) : std::nullopt;
+		if (manifest) {
+			onManifestReceived(*manifest);
+		} else if (code == 401) {
+			promise.setValue(Result::Unauthorized);
+		} else {
+			promise.setValue(Result::Unsupported);
+		}
+	});
+
+	return result;
+}
+
+void ProjectSync::onManifestReceived(const Bytes& manifestBytes)
+{
+	localFiles = loadManifest(manifestPath);
+
+	// Nothing has been requested yet, so a malformed manifest can still fail the whole sync here
+	try {
+		const auto manifest = JSONConvert::parseConfig(manifestBytes);
+		for (const auto& fileNode: manifest["files"].asSequence()) {
+			const auto path = fileNode["path"].asString("");
+			if (!ZipReader::isSafeName(path)) {
+				Logger::logWarning("Skipping unsafe path \"" + path + "\" in manifest for " + project);
+				continue;
+			}
+
+			FileInfo info;
+			info.size = static_cast<uint64_t>(fileNode["size"].asInt64(0));
+			info.sha256 = fileNode["sha256"].asString("");
+			if (!isUpToDate(path, info)) {
+				pending.push_back(path);
+			}
+			remoteFiles[path] = std::move(info);
+		}
+	} catch (const std::exception& e) {
+		Logger::logError("Invalid manifest for " + project + ": " + e.what());
+		promise.setValue(Result::Failed);
+		return;
+	}
+
+	// Remove files we synced before, but which are no longer on the server. A pending sync leaves that to applyPending,
+	// which finds them by comparing the manifests.
+	for (auto iter = localFiles.begin(); iter != localFiles.end();) {
+		if (remoteFiles.find(iter->first) == remoteFiles.end()) {
+			if (!pendingPath) {
+				std::error_code ec;
+				std::filesystem::remove((localPath / iter->first).getString().cppStr(), ec);
+			}
+			iter = localFiles.erase(iter);
+			changed = true;
+		} else {
+			++iter;
+		}
+	}
+
+	if (!pending.empty()) {
+		changed = true;
+		Logger::logInfo("Syncing " + toString(pending.size()) + " of " + toString(remoteFiles.size()) + " files for " + project);
+	}
+
+	for (int i = 0; i < maxConcurrentRequests; ++i) {
+		fetchNext();
+	}
+}
+
+void ProjectSync::fetchNext()
+{
+	String path;
+	{
+		auto lock = std::unique_lock(mutex);
+		if (pending.empty() || failed) {
+			if (inFlight == 0 && !finished) {
+				finished = true;
+				lock.unlock();
+				finish();
+			}
+			return;
+		}
+		path = std::move(pending.back());
+		pending.pop_back();
+		++inFlight;
+	}
+
+	const auto url = baseURL + "/external-project-files/" + Encode::encodeURL(project) + "?path=" + Encode::encodeURL(path);
+	auto request = webAPI.makeHTTPRequest(HTTPMethod::GET, url);
+	request->setHeader("Authorization", "Bearer " + token);
+	request->setHeader("Accept-Encoding", "gzip");
+	request->send().then([this, self = shared_from_this(), path] (std::unique_ptr<HTTPResponse> response)
+	{
+		onFileReceived(path, std::move(response));
+	});
+}
+
+void ProjectSync::onFileReceived(const String& path, std::unique_ptr<HTTPResponse> response)
+{
+	const auto& remote = remoteFiles.at(path);
+	bool ok = false;
+
+	if (response->getResponseCode() == 200) {
+		const auto bytes = response->moveBody();
+		const auto dstPath = getWritePath(path);
+		std::error_code ec;
+		std::filesystem::create_directories(dstPath.parentPath().getString().cppStr(), ec);
+
+		// Compressed responses are only recognised by their magic number, so check the body as-is first,
+		// in case the file itself is gzip data
+		if (isExpectedContent(bytes, remote)) {
+			ok = Path::writeFile(dstPath, bytes);
+			if (!ok) {
+				Logger::logError("Could not write " + toString(bytes.size()) + " bytes to " + dstPath.getNativeString(false));
+			}
+		} else if (GZipDecoder::isGZip(bytes.byte_span())) {
+			ok = writeDecoded(bytes, dstPath, remote);
+		} else {
+			Logger::logError("Checksum mismatch syncing " + path);
+		}
+	} else {
+		Logger::logError("HTTP Error " + toString(response->getResponseCode()) + " syncing " + path);
+	}
+
+	{
+		auto lock = std::unique_lock(mutex);
+		--inFlight;
+		if (ok) {
+			localFiles[path] = remote;
+		} else {
+			failed = true;
+			unauthorized = unauthorized || response->getResponseCode() == 401;
+		}
+	}
+
+	fetchNext();
+}
+
+void ProjectSync::finish()
+{
+	if (pendingPath) {
+		// Only a complete sync is kept for applying, so the project never ends up half updated
+		if (failed || !changed) {
+			std::error_code ec;
+			std::filesystem::remove_all(pendingPath->getString().cppStr(), ec);
+		} else {
+			saveManifest(*pendingPath / "manifest", localFiles);
+		}
+	} else {
+		// Always record what we did sync, so a retry only fetches what's still missing
+		saveManifest(manifestPath, localFiles);
+	}
+
+	if (unauthorized) {
+		promise.setValue(Result::Unauthorized);
+	} else if (failed) {
+		promise.setValue(Result::Failed);
+	} else {
+		promise.setValue(changed ? Result::Synced : Result::UpToDate);
+	}
+}
+
+Path ProjectSync::getPendingFilesPath(const Path& pendingPath)
+{
+	return pendingPath / "files";
+}
+
+bool ProjectSync::applyPending(const Path& localPath, const Path& manifestPath, const Path& pendingPath)
+{
+	std::error_code ec;
+	if (!std::filesystem::exists(pendingPath.getString().cppStr(), ec)) {
+		return true;
+	}
+
+	if (!ProjectDataFolders::moveFiles(getPendingFilesPath(pendingPath), localPath)) {
+		return false;
+	}
+
+	// A full download has no manifest, and doesn't remove anything
+	const auto pendingManifestPath = pendingPath / "manifest";
+	if (std::filesystem::exists(pendingManifestPath.getString().cppStr(), ec)) {
+		const auto newFiles = loadManifest(pendingManifestPath);
+		for (const auto& [path, info]: loadManifest(manifestPath)) {
+			if (newFiles.find(path) == newFiles.end()) {
+				std::filesystem::remove((localPath / path).getString().cppStr(), ec);
+			}
+		}
+		saveManifest(manifestPath, newFiles);
+	}
+
+	std::filesystem::remove_all(pendingPath.getString().cppStr(), ec);
+	return true;
+}
+
+bool ProjectSync::isExpectedContent(const Bytes& bytes, const FileInfo& remote) const
+{
+	if (bytes.size() != remote.size) {
+		return false;
+	}
+	SHA256Hasher hasher;
+	hasher.feed(bytes);
+	return SHA256Hasher::toHex(hasher.digest().byte_span()) == remote.sha256;
+}
+
+bool ProjectSync::writeDecoded(const Bytes& bytes, const Path& dstPath, const FileInfo& remote) const
+{
+	// Decoded straight to disk and hashed on the way, so the decompressed file is never held in memory
+	FileWriter writer;
+	SHA256Hasher hasher;
+	uint64_t size = 0;
+	GZipDecoder decoder([&] (gsl::span<const gsl::byte> data) -> bool
+	{
+		size += data.size();
+		hasher.feed(data);
+		return size <= remote.size && writer.write(data);
+	});
+
+	const bool decoded = writer.open(dstPath, remote.size) && decoder.feed(bytes.byte_span()) && decoder.finish();
+	const bool written = writer.close();
+	if (decoded && written && size == remote.size && SHA256Hasher::toHex(hasher.digest().byte_span()) == remote.sha256) {
+		return true;
+	}
+
+	Logger::logError("Checksum mismatch syncing " + dstPath.getNativeString(false));
+	std::error_code ec;
+	std::filesystem::remove(dstPath.getString().cppStr(), ec);
+	return false;
+}
+
+bool ProjectSync::isUpToDate(const String& path, const FileInfo& remote) const
+{
+	const auto iter = localFiles.find(path);
+	if (iter == localFiles.end() || iter->second.sha256 != remote.sha256 || iter->second.size != remote.size) {
+		return false;
+	}
+
+	std::error_code ec;
+	const auto size = std::filesystem::file_size((localPath / path).getString().cppStr(), ec);
+	return !ec && size == remote.size;
+}
+
+Path ProjectSync::getWritePath(const String& path) const
+{
+	return (pendingPath ? getPendingFilesPath(*pendingPath) : localPath) / path;
+}
+
+HashMap<String, ProjectSync::FileInfo> ProjectSync::loadManifest(const Path& path)
+{
+	HashMap<String, FileInfo> files;
+	const auto bytes = Path::readFile(path);
+	if (bytes.empty()) {
+		return files;
+	}
+
+	const auto manifest = Deserializer::fromBytes<ConfigFile>(bytes);
+	for (const auto& [filePath, node]: manifest.getRoot()["files"].asMap()) {
+		if (!ZipReader::isSafeName(filePath)) {
+			continue;
+		}
+		FileInfo info;
+		info.size = static_cast<uint64_t>(node["size"].asInt64(0));
+		info.sha256 = node["sha256"].asString("");
+		files[filePath] = std::move(info);
+	}
+	return files;
+}
+
+void ProjectSync::saveManifest(const Path& path, const HashMap<String, FileInfo>& files)
+{
+	ConfigNode::MapType filesNode;
+	for (const auto& [filePath, info]: files) {
+		ConfigNode::MapType node;
+		node["size"] = static_cast<int64_t>(info.size);
+		node["sha256"] = info.sha256;
+		filesNode[filePath] = std::move(node);
+	}
+
+	ConfigFile manifest;
+	manifest.getRoot() = ConfigNode::MapType();
+	manifest.getRoot()["files"] = std::move(filesNode);
+
+	std::error_code ec;
+	std::filesystem::create_directories(path.parentPath().getString().cppStr(), ec);
+	Path::writeFile(path, Serializer::toBytes(manifest));
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <halley.hpp>
+using namespace Halley;
+
+// Incrementally syncs a web project to disk.
+// The server lists every file with its size and hash, and only new or changed files are fetched.
+// What was synced is recorded at manifestPath, outside the project.
+// Given a pending path, the project is left untouched: changed files and the new manifest are written there instead, and
+// applyPending moves them into place later (e.g. on the next launch, so an editor that has the project open never sees it change).
+class ProjectSync : public std::enable_shared_from_this<ProjectSync> {
+public:
+	enum class Result {
+		Synced,
+		UpToDate,
+		Failed,
+		Unsupported, // Server doesn't support manifests
+		Unauthorized
+	};
+
+	constexpr static int maxConcurrentRequests = 4;
+
+	ProjectSync(WebAPI& webAPI, String baseURL, String project, String token, Path localPath, Path manifestPath, std::optional<Path> pendingPath = {});
+
+	Future<Result> run();
+
+	// Where a pending sync writes the project's files
+	static Path getPendingFilesPath(const Path& pendingPath);
+	// Returns false if some files couldn't be moved, in which case they stay pending, and the old manifest is kept
+	static bool applyPending(const Path& localPath, const Path& manifestPath, const Path& pendingPath);
+
+private:
+	struct FileInfo {
+		uint64_t size = 0;
+		String sha256;
+	};
+
+	WebAPI& webAPI;
+	String baseURL;
+	String project;
+	String token;
+	Path localPath;
+	Path manifestPath;
+	std::optional<Path> pendingPath;
+
+	Promise<Result> promise;
+	std::mutex mutex;
+	HashMap<String, FileInfo> localFiles;
+	HashMap<String, FileInfo> remoteFiles;
+	Vector<String> pending;
+	int inFlight = 0;
+	bool failed = false;
+	bool unauthorized = false;
+	bool changed = false;
+	bool finished = false;
+
+	void onManifestReceived(const Bytes& manifestBytes);
+	void fetchNext();
+	void onFileReceived(const String& path, std::unique_ptr<HTTPResponse> response);
+	void finish();
+
+	bool isExpectedContent(const Bytes& bytes, const FileInfo& remote) const;
+	bool writeDecoded(const Bytes& bytes, const Path& dstPath, const FileInfo& remote) const;
+	bool isUpToDate(const String& path, const FileInfo& remote) const;
+	Path getWritePath(const String& path) const;
+
+	static HashMap<String, FileInfo> loadManifest(const Path& path);
+	static void saveManifest(const Path& path, const HashMap<String, FileInfo>& files);
+};
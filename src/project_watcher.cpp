@@ -0,0 +1,457 @@
+#include "project_watcher.h"
+
+#include <chrono>
+
+#include "launcher_project_properties.h"
+
+#ifdef __linux__
+#include <cerrno>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#elif defined(_WIN32)
+#include <cwctype>
+#include <filesystem>
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#endif
+
+#ifdef _WIN32
+struct ProjectWatcher::DirectoryWatch {
+	String project;
+	HANDLE handle = INVALID_HANDLE_VALUE;
+	OVERLAPPED overlapped = {};
+	std::set<std::wstring> names; // Source files and the folders they're in, as reported in change notifications
+	alignas(DWORD) char buffer[16 * 1024];
+};
+
+namespace {
+	std::wstring toWatchedName(std::wstring name)
+	{
+		for (auto& c: name) {
+			c = c == L'/' ? L'\\' : static_cast<wchar_t>(std::towlower(c));
+		}
+		return name;
+	}
+}
+#endif
+
+ProjectWatcher::ProjectWatcher()
+{
+#ifdef __linux__
+	inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (inotifyFd < 0) {
+		Logger::logWarning("Unable to use inotify, polling project files for changes instead.");
+	}
+#elif defined(_WIN32)
+	completionPort = CreateIoCompletionPort(INVALID_HANDLE_VALUE, nullptr, 0, 1);
+	if (!completionPort) {
+		Logger::logWarning("Unable to watch for file changes, polling project files for changes instead.");
+	}
+#endif
+
+	thread = std::thread([this] () { run(); });
+}
+
+ProjectWatcher::~ProjectWatcher()
+{
+	{
+		auto lock = std::unique_lock(mutex);
+		stopping = true;
+	}
+	thread.join();
+
+#ifdef __linux__
+	if (inotifyFd >= 0) {
+		close(inotifyFd);
+	}
+#elif defined(_WIN32)
+	if (completionPort) {
+		Vector<String> projects;
+		for (const auto& [project, watch]: directoryWatches) {
+			projects.push_back(project);
+		}
+		for (const auto& project: projects) {
+			removeWatches(project);
+		}
+
+		// The cancelled reads still complete, and their buffers can't be freed until they do
+		while (!closingWatches.empty()) {
+			DWORD bytes = 0;
+			ULONG_PTR key = 0;
+			OVERLAPPED* overlapped = nullptr;
+			GetQueuedCompletionStatus(completionPort, &bytes, &key, &overlapped, waitIntervalMs);
+			if (!overlapped) {
+				// Leaked rather than freed while the system might still write to them
+				for (auto& watch: closingWatches) {
+					watch.release();
+				}
+				break;
+			}
+			onWatchClosed(reinterpret_cast<const DirectoryWatch*>(key));
+		}
+		CloseHandle(completionPort);
+	}
+#endif
+}
+
+void ProjectWatcher::addProject(const Path& path)
+{
+	// Setting up the watches touches the disk, so it's left to the watcher thread
+	auto lock = std::unique_lock(mutex);
+	pendingAdds.push_back(path.getString());
+}
+
+void ProjectWatcher::removeProject(const Path& path)
+{
+	auto lock = std::unique_lock(mutex);
+	pendingRemoves.push_back(path.getString());
+	changed.erase(path.getString());
+}
+
+Vector<Path> ProjectWatcher::getChangedProjects()
+{
+	auto lock = std::unique_lock(mutex);
+	Vector<Path> result;
+	for (const auto& project: changed) {
+		result.push_back(Path(project));
+	}
+	changed.clear();
+	return result;
+}
+
+void ProjectWatcher::run()
+{
+	auto nextPoll = std::chrono::steady_clock::now() + std::chrono::milliseconds(pollIntervalMs);
+
+	while (true) {
+		Vector<String> toAdd;
+		Vector<String> toRemove;
+		{
+			auto lock = std::unique_lock(mutex);
+			if (stopping) {
+				break;
+			}
+			toAdd = std::move(pendingAdds);
+			pendingAdds.clear();
+			toRemove = std::move(pendingRemoves);
+			pendingRemoves.clear();
+		}
+
+		for (const auto& project: toRemove) {
+			stopWatching(project);
+		}
+		for (const auto& project: toAdd) {
+			startWatching(project);
+		}
+
+		waitForEvents();
+
+		const auto now = std::chrono::steady_clock::now();
+		if (now >= nextPoll) {
+			pollProjects();
+			nextPoll = now + std::chrono::milliseconds(pollIntervalMs);
+		}
+	}
+}
+
+void ProjectWatcher::startWatching(const String& project)
+{
+	if (addWatches(project)) {
+		return;
+	}
+
+	// These are the same stamps the properties cache checks, so a change here is exactly a change that needs the project read again
+	removeWatches(project);
+	polledProjects[project] = LauncherProjectProperties::getSourceStamps(Path(project));
+}
+
+void ProjectWatcher::stopWatching(const String& project)
+{
+	removeWatches(project);
+	polledProjects.erase(project);
+}
+
+void ProjectWatcher::pollProjects()
+{
+	for (auto& [project, stamps]: polledProjects) {
+		auto newStamps = LauncherProjectProperties::getSourceStamps(Path(project));
+		if (newStamps != stamps) {
+			stamps = std::move(newStamps);
+			markChanged(project);
+		}
+	}
+}
+
+void ProjectWatcher::markChanged(const String& project)
+{
+	auto lock = std::unique_lock(mutex);
+	changed.insert(project);
+}
+
+#ifdef __linux__
+
+bool ProjectWatcher::addWatches(const String& project)
+{
+	if (inotifyFd < 0) {
+		return false;
+	}
+
+	// Every folder on the way to each source file is watched, as creating or replacing any of them (e.g. the first build creating
+	// halley/bin) can change the properties
+	HashMap<String, std::set<String>> folders;
+	for (const auto* file: LauncherProjectProperties::getSourceFiles()) {
+		const auto parts = String(file).split('/');
+		String folder;
+		for (const auto& part: parts) {
+			folders[folder].insert(part);
+			if (!folder.isEmpty()) {
+				folder += "/";
+			}
+			folder += part;
+		}
+	}
+
+	constexpr uint32_t mask = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_CLOSE_WRITE | IN_ATTRIB | IN_ONLYDIR;
+	for (auto& [folder, names]: folders) {
+		const auto isRoot = folder.isEmpty();
+		const auto path = isRoot ? Path(project) : Path(project) / folder;
+		const int wd = inotify_add_watch(inotifyFd, path.getString().c_str(), mask | (isRoot ? IN_DELETE_SELF | IN_MOVE_SELF : 0));
+		if (wd < 0) {
+			// Folders which don't exist yet are picked up when their parent reports them being created
+			if (errno == ENOENT && !isRoot) {
+				continue;
+			}
+			return false;
+		}
+		watches[wd] = Watch{ project, std::move(names) };
+		projectWatches[project].insert(wd);
+	}
+	return true;
+}
+
+void ProjectWatcher::removeWatches(const String& project)
+{
+	const auto iter = projectWatches.find(project);
+	if (iter == projectWatches.end()) {
+		return;
+	}
+	for (const auto wd: iter->second) {
+		inotify_rm_watch(inotifyFd, wd);
+		watches.erase(wd);
+	}
+	projectWatches.erase(iter);
+}
+
+void ProjectWatcher::waitForEvents()
+{
+	if (inotifyFd < 0) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(waitIntervalMs));
+		return;
+	}
+
+	pollfd fd = { inotifyFd, POLLIN, 0 };
+	if (::poll(&fd, 1, waitIntervalMs) <= 0) {
+		return;
+	}
+
+	std::set<String> changedProjects;
+	alignas(inotify_event) char buffer[16 * 1024];
+	while (true) {
+		const auto len = ::read(inotifyFd, buffer, sizeof(buffer));
+		if (len <= 0) {
+			break;
+		}
+
+		for (const char* ptr = buffer; ptr < buffer + len; ) {
+			const auto* event = reinterpret_cast<const inotify_event*>(ptr);
+			ptr += sizeof(inotify_event) + event->len;
+
+			if (event->mask & IN_Q_OVERFLOW) {
+				// Events were lost, so anything could have changed
+				for (const auto& [project, wds]: projectWatches) {
+					changedProjects.insert(project);
+				}
+				continue;
+			}
+
+			const auto iter = watches.find(event->wd);
+			if (iter == watches.end()) {
+				continue;
+			}
+
+			if (event->mask & IN_IGNORED) {
+				// The folder is gone, so the watch was dropped
+				changedProjects.insert(iter->second.project);
+				projectWatches[iter->second.project].erase(event->wd);
+				watches.erase(iter);
+			} else if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF)) {
+				changedProjects.insert(iter->second.project);
+			} else if (event->len > 0 && iter->second.names.find(String(event->name)) != iter->second.names.end()) {
+				changedProjects.insert(iter->second.project);
+			}
+		}
+	}
+
+	for (const auto& project: changedProjects) {
+		// Watch any folders which were just created; ones which are already watched keep their descriptor
+		startWatching(project);
+		markChanged(project);
+	}
+}
+
+#elif defined(_WIN32)
+
+bool ProjectWatcher::addWatches(const String& project)
+{
+	if (!completionPort) {
+		return false;
+	}
+	if (directoryWatches.find(project) != directoryWatches.end()) {
+		return true;
+	}
+
+	// A single recursive watch on the project's folder sees every source file, and every folder on the way to them
+	auto watch = std::make_unique<DirectoryWatch>();
+	watch->project = project;
+	for (const auto* file: LauncherProjectProperties::getSourceFiles()) {
+		const auto name = toWatchedName(std::filesystem::path(file).wstring());
+		for (auto pos = name.find(L'\\'); pos != std::wstring::npos; pos = name.find(L'\\', pos + 1)) {
+			watch->names.insert(name.substr(0, pos));
+		}
+		watch->names.insert(name);
+	}
+
+	const auto widePath = std::filesystem::path(project.cppStr()).wstring();
+	watch->handle = CreateFileW(widePath.c_str(), FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+	if (watch->handle == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+	if (!CreateIoCompletionPort(watch->handle, completionPort, reinterpret_cast<ULONG_PTR>(watch.get()), 0) || !readChanges(*watch)) {
+		CloseHandle(watch->handle);
+		return false;
+	}
+
+	directoryWatches[project] = std::move(watch);
+	return true;
+}
+
+void ProjectWatcher::removeWatches(const String& project)
+{
+	const auto iter = directoryWatches.find(project);
+	if (iter == directoryWatches.end()) {
+		return;
+	}
+
+	// The read in flight completes as aborted once cancelled, and the watch has to outlive it
+	auto& watch = *iter->second;
+	CancelIoEx(watch.handle, &watch.overlapped);
+	CloseHandle(watch.handle);
+	watch.handle = INVALID_HANDLE_VALUE;
+	closingWatches.push_back(std::move(iter->second));
+	directoryWatches.erase(iter);
+}
+
+void ProjectWatcher::waitForEvents()
+{
+	if (!completionPort) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(waitIntervalMs));
+		return;
+	}
+
+	std::set<String> changedProjects;
+	DWORD timeout = waitIntervalMs;
+	while (true) {
+		DWORD bytes = 0;
+		ULONG_PTR key = 0;
+		OVERLAPPED* overlapped = nullptr;
+		const bool ok = GetQueuedCompletionStatus(completionPort, &bytes, &key, &overlapped, timeout) != 0;
+		if (!overlapped) {
+			break;
+		}
+		timeout = 0;
+
+		auto* watch = reinterpret_cast<DirectoryWatch*>(key);
+		if (onWatchClosed(watch)) {
+			continue;
+		}
+
+		// Zero bytes means more changed than fit in the buffer, so anything could have
+		const auto project = watch->project;
+		if (!ok || bytes == 0 || isRelevantChange(*watch, bytes)) {
+			changedProjects.insert(project);
+		}
+
+		if (!ok || !readChanges(*watch)) {
+			// The folder is gone, or can't be watched any more. Nothing is in flight, so it can go straight away.
+			CloseHandle(watch->handle);
+			directoryWatches.erase(project);
+			changedProjects.insert(project);
+		}
+	}
+
+	for (const auto& project: changedProjects) {
+		// Watches which were dropped are set up again, or the project is polled if that's not possible
+		startWatching(project);
+		markChanged(project);
+	}
+}
+
+bool ProjectWatcher::readChanges(DirectoryWatch& watch)
+{
+	constexpr DWORD filter = FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME | FILE_NOTIFY_CHANGE_SIZE | FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_CREATION;
+	watch.overlapped = {};
+	return ReadDirectoryChangesW(watch.handle, watch.buffer, sizeof(watch.buffer), TRUE, filter, nullptr, &watch.overlapped, nullptr) != 0;
+}
+
+bool ProjectWatcher::onWatchClosed(const DirectoryWatch* watch)
+{
+	const auto iter = std::find_if(closingWatches.begin(), closingWatches.end(), [&] (const std::unique_ptr<DirectoryWatch>& closing)
+	{
+		return closing.get() == watch;
+	});
+	if (iter == closingWatches.end()) {
+		return false;
+	}
+	closingWatches.erase(iter);
+	return true;
+}
+
+bool ProjectWatcher::isRelevantChange(const DirectoryWatch& watch, size_t bytes)
+{
+	for (size_t offset = 0; offset < bytes; ) {
+		const auto* info = reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(watch.buffer + offset);
+		const auto name = toWatchedName(std::wstring(info->FileName, info->FileNameLength / sizeof(WCHAR)));
+		if (watch.names.find(name) != watch.names.end()) {
+			return true;
+		}
+		if (info->NextEntryOffset == 0) {
+			break;
+		}
+		offset += info->NextEntryOffset;
+	}
+	return false;
+}
+
+#else
+
+bool ProjectWatcher::addWatches(const String& project)
+{
+	return false;
+}
+
+void ProjectWatcher::removeWatches(const String& project)
+{
+}
+
+void ProjectWatcher::waitForEvents()
+{
+	std::this_thread::sleep_for(std::chrono::milliseconds(waitIntervalMs));
+}
+
+#endif
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <halley.hpp>
+
+#include <set>
+#include <thread>
+using namespace Halley;
+
+// Watches the files each project's properties are read from (see LauncherProjectProperties::getSourceFiles) on a background thread,
+// and reports which projects changed, so only those need to be read again. Deleted projects are reported as changed too.
+// Uses inotify on Linux, and ReadDirectoryChangesW on Windows. Elsewhere, or for projects which can't be watched (e.g. out of
+// inotify watches, or on a drive which doesn't support change notifications), the files are polled instead.
+class ProjectWatcher {
+public:
+	constexpr static int waitIntervalMs = 100; // Also how long destroying the watcher can take
+	constexpr static int pollIntervalMs = 2000;
+
+	ProjectWatcher();
+	~ProjectWatcher();
+
+	ProjectWatcher(const ProjectWatcher& other) = delete;
+	ProjectWatcher& operator=(const ProjectWatcher& other) = delete;
+
+	void addProject(const Path& path);
+	void removeProject(const Path& path);
+
+	// Projects which changed since the last call
+	Vector<Path> getChangedProjects();
+
+private:
+	struct Watch {
+		String project;
+		std::set<String> names; // Entries of the watched folder which matter; events for anything else are ignored
+	};
+
+	std::thread thread;
+	std::mutex mutex;
+	bool stopping = false;
+	Vector<String> pendingAdds;
+	Vector<String> pendingRemoves;
+	std::set<String> changed;
+
+	// Only used by the watcher thread
+#ifdef _WIN32
+	struct DirectoryWatch;
+	void* completionPort = nullptr;
+	HashMap<String, std::unique_ptr<DirectoryWatch>> directoryWatches;
+	Vector<std::unique_ptr<DirectoryWatch>> closingWatches; // Cancelled, but kept alive until the system is done with their buffer
+#else
+	int inotifyFd = -1;
+	HashMap<int, Watch> watches;
+	HashMap<String, std::set<int>> projectWatches;
+#endif
+	HashMap<String, Vector<int64_t>> polledProjects;
+
+	void run();
+	void startWatching(const String& project);
+	void stopWatching(const String& project);
+	void pollProjects();
+	void markChanged(const String& project);
+
+	bool addWatches(const String& project);
+	void removeWatches(const String& project);
+	void waitForEvents();
+#ifdef _WIN32
+	bool readChanges(DirectoryWatch& watch);
+	bool onWatchClosed(const DirectoryWatch* watch);
+	static bool isRelevantChange(const DirectoryWatch& watch, size_t bytes);
+#endif
+};
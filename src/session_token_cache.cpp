@@ -0,0 +1,81 @@
+#include "session_token_cache.h"
+
+#include <ctime>
+
+SessionTokenCache::SessionTokenCache(Path filePath)
+	: filePath(std::move(filePath))
+{
+}
+
+std::optional<String> SessionTokenCache::get(const String& url, const String& project, const String& username)
+{
+	auto lock = std::unique_lock(mutex);
+	load();
+
+	const auto key = getKey(url, project, username);
+	if (!tokens.hasKey(key)) {
+		return std::nullopt;
+	}
+
+	const auto& entry = tokens[key];
+	if (entry["expiresAt"].asInt64(0) - expiryMargin <= static_cast<int64_t>(std::time(nullptr))) {
+		tokens.removeKey(key);
+		save();
+		return std::nullopt;
+	}
+	return entry["token"].asString("");
+}
+
+void SessionTokenCache::store(const String& url, const String& project, const String& username, const String& token, int64_t lifetimeSeconds)
+{
+	auto lock = std::unique_lock(mutex);
+	load();
+
+	ConfigNode::MapType entry;
+	entry["token"] = token;
+	entry["expiresAt"] = static_cast<int64_t>(std::time(nullptr)) + lifetimeSeconds;
+	tokens[getKey(url, project, username)] = std::move(entry);
+	save();
+}
+
+void SessionTokenCache::invalidate(const String& url, const String& project, const String& username)
+{
+	auto lock = std::unique_lock(mutex);
+	load();
+
+	const auto key = getKey(url, project, username);
+	if (tokens.hasKey(key)) {
+		tokens.removeKey(key);
+		save();
+	}
+}
+
+void SessionTokenCache::load()
+{
+	if (!loaded) {
+		loaded = true;
+		const auto bytes = Path::readFile(filePath);
+		if (!bytes.empty()) {
+			tokens = ConfigNode(Deserializer::fromBytes<ConfigFile>(bytes).getRoot());
+		}
+		if (tokens.getType() != ConfigNodeType::Map) {
+			tokens = ConfigNode::MapType();
+		}
+	}
+}
+
+void SessionTokenCache::save() const
+{
+	ConfigFile file;
+	file.getRoot() = ConfigNode(tokens);
+	Path::writeFile(filePath, Serializer::toBytes(file));
+}
+
+String SessionTokenCache::getKey(const String& url, const String& project, const String& username) const
+{
+	Hash::Hasher hasher;
+	hasher.feed(url);
+	hasher.feed(project);
+	hasher.feed(username);
+	return toString(hasher.digest(), 16);
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <halley.hpp>
+using namespace Halley;
+
+// Remembers the bearer tokens handed out by web project servers, keyed by (url, project, username),
+// so launching a web project doesn't need a login round trip until the token expires or is rejected.
+class SessionTokenCache {
+public:
+	constexpr static int64_t defaultLifetime = 8 * 60 * 60;
+	constexpr static int64_t expiryMargin = 60;
+
+	SessionTokenCache(Path filePath);
+
+	std::optional<String> get(const String& url, const String& project, const String& username);
+	void store(const String& url, const String& project, const String& username, const String& token, int64_t lifetimeSeconds = defaultLifetime);
+	void invalidate(const String& url, const String& project, const String& username);
+
+private:
+	Path filePath;
+	std::mutex mutex;
+	ConfigNode tokens;
+	bool loaded = false;
+
+	void load();
+	void save() const;
+	String getKey(const String& url, const String& project, const String& username) const;
+};
@@ -0,0 +1,155 @@
+#include "sha256.h"
+
+#include <fstream>
+
+namespace {
+	constexpr std::array<uint32_t, 64> roundConstants = {
+		0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+		0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+		0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+		0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+		0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+		0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+		0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+		0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+	};
+
+	constexpr uint32_t rotateRight(uint32_t value, int bits)
+	{
+		return (value >> bits) | (value << (32 - bits));
+	}
+}
+
+SHA256Hasher::SHA256Hasher()
+	: state({ 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 })
+{
+}
+
+void SHA256Hasher::feed(gsl::span<const gsl::byte> data)
+{
+	const auto* src = reinterpret_cast<const uint8_t*>(data.data());
+	size_t remaining = data.size();
+	totalSize += remaining;
+
+	if (blockSize > 0) {
+		const size_t n = std::min(remaining, block.size() - blockSize);
+		memcpy(block.data() + blockSize, src, n);
+		blockSize += n;
+		src += n;
+		remaining -= n;
+		if (blockSize == block.size()) {
+			processBlock(block.data());
+			blockSize = 0;
+		}
+	}
+
+	while (remaining >= block.size()) {
+		processBlock(src);
+		src += block.size();
+		remaining -= block.size();
+	}
+
+	if (remaining > 0) {
+		memcpy(block.data(), src, remaining);
+		blockSize = remaining;
+	}
+}
+
+void SHA256Hasher::feed(const Bytes& data)
+{
+	feed(data.byte_span());
+}
+
+Bytes SHA256Hasher::digest()
+{
+	const uint64_t totalBits = totalSize * 8;
+
+	std::array<uint8_t, 72> padding = {};
+	padding[0] = 0x80;
+	const size_t padSize = (blockSize < 56 ? 56 : 120) - blockSize;
+	for (int i = 0; i < 8; ++i) {
+		padding[padSize + i] = static_cast<uint8_t>(totalBits >> (56 - 8 * i));
+	}
+	feed(gsl::as_bytes(gsl::span<const uint8_t>(padding.data(), padSize + 8)));
+
+	Bytes result(digestSize);
+	auto* dst = reinterpret_cast<uint8_t*>(result.data());
+	for (size_t i = 0; i < state.size(); ++i) {
+		dst[i * 4 + 0] = static_cast<uint8_t>(state[i] >> 24);
+		dst[i * 4 + 1] = static_cast<uint8_t>(state[i] >> 16);
+		dst[i * 4 + 2] = static_cast<uint8_t>(state[i] >> 8);
+		dst[i * 4 + 3] = static_cast<uint8_t>(state[i]);
+	}
+	return result;
+}
+
+String SHA256Hasher::toHex(gsl::span<const gsl::byte> digest)
+{
+	constexpr const char* digits = "0123456789abcdef";
+	std::string result;
+	result.reserve(digest.size() * 2);
+	for (const auto b: digest) {
+		const auto value = static_cast<uint8_t>(b);
+		result.push_back(digits[value >> 4]);
+		result.push_back(digits[value & 0xF]);
+	}
+	return result;
+}
+
+std::optional<Bytes> SHA256Hasher::hashFile(const Path& path)
+{
+	std::ifstream file(path.getString().cppStr(), std::ios::binary);
+	if (!file) {
+		return std::nullopt;
+	}
+
+	SHA256Hasher hasher;
+	Bytes buffer(1024 * 1024);
+	while (file) {
+		file.read(reinterpret_cast<char*>(buffer.data()), static_cast<std::streamsize>(buffer.size()));
+		const auto n = static_cast<size_t>(file.gcount());
+		hasher.feed(buffer.byte_span().subspan(0, n));
+	}
+	return hasher.digest();
+}
+
+void SHA256Hasher::processBlock(const uint8_t* data)
+{
+	std::array<uint32_t, 64> w;
+	for (size_t i = 0; i < 16; ++i) {
+		w[i] = (uint32_t(data[i * 4]) << 24) | (uint32_t(data[i * 4 + 1]) << 16) | (uint32_t(data[i * 4 + 2]) << 8) | uint32_t(data[i * 4 + 3]);
+	}
+	for (size_t i = 16; i < 64; ++i) {
+		const uint32_t s0 = rotateRight(w[i - 15], 7) ^ rotateRight(w[i - 15], 18) ^ (w[i - 15] >> 3);
+		const uint32_t s1 = rotateRight(w[i - 2], 17) ^ rotateRight(w[i - 2], 19) ^ (w[i - 2] >> 10);
+		w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+	}
+
+	auto [a, b, c, d, e, f, g, h] = state;
+	for (size_t i = 0; i < 64; ++i) {
+		const uint32_t s1 = rotateRight(e, 6) ^ rotateRight(e, 11) ^ rotateRight(e, 25);
+		const uint32_t ch = (e & f) ^ (~e & g);
+		const uint32_t t1 = h + s1 + ch + roundConstants[i] + w[i];
+		const uint32_t s0 = rotateRight(a, 2) ^ rotateRight(a, 13) ^ rotateRight(a, 22);
+		const uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
+		const uint32_t t2 = s0 + maj;
+
+		h = g;
+		g = f;
+		f = e;
+		e = d + t1;
+		d = c;
+		c = b;
+		b = a;
+		a = t1 + t2;
+	}
+
+	state[0] += a;
+	state[1] += b;
+	state[2] += c;
+	state[3] += d;
+	state[4] += e;
+	state[5] += f;
+	state[6] += g;
+	state[7] += h;
+}
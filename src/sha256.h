@@ -0,0 +1,27 @@
+#pragma once
+
+#include <halley.hpp>
+using namespace Halley;
+
+// Incremental SHA-256, so large files can be hashed as they're read or downloaded
+class SHA256Hasher {
+public:
+	constexpr static size_t digestSize = 32;
+
+	SHA256Hasher();
+
+	void feed(gsl::span<const gsl::byte> data);
+	void feed(const Bytes& data);
+	Bytes digest();
+
+	static String toHex(gsl::span<const gsl::byte> digest);
+	static std::optional<Bytes> hashFile(const Path& path);
+
+private:
+	std::array<uint32_t, 8> state;
+	std::array<uint8_t, 64> block;
+	size_t blockSize = 0;
+	uint64_t totalSize = 0;
+
+	void processBlock(const uint8_t* data);
+};
@@ -2,7 +2,9 @@
 
 #include <filesystem>
 
+#include "launcher_signature.h"
 #include "launcher_stage.h"
+#include "zip_extractor.h"
 
 Update::Update(UIFactory& factory, ILauncher& parent, NewVersionInfo info)
 	: UIWidget("update", {}, UISizer())
@@ -43,13 +45,12 @@ void Update::update(Time t, bool moved)
 	doUpdateProgress();
 }
 
-void Update::download(const String& url, int depth)
+void Update::download(const String& url)
 {
 	downloading = true;
-	auto request = parent.getHalleyAPI().web->makeHTTPRequest(HTTPMethod::GET, url);
 	auto weakThis = weak_from_this();
 	updateDownloadProgress(0, 1);
-	request->setProgressCallback([weakThis] (uint64_t cur, uint64_t total) -> bool
+	downloadFuture = parent.getWebClient().downloadFile(url, "halley-launcher.zip", [weakThis] (uint64_t cur, uint64_t total) -> bool
 	{
 		auto ptr = weakThis.lock();
 		if (ptr) {
@@ -60,33 +61,31 @@ void Update::download(const String& url, int depth)
 		}
 		return !!ptr;
 	});
-	downloadFuture = request->send();
-	downloadFuture.then(Executors::getMainUpdateThread(), [this, depth](std::unique_ptr<HTTPResponse> response)
+	downloadFuture.then(Executors::getMainUpdateThread(), [this](std::optional<WebClient::DownloadedFile> download)
 	{
-		onDownloadComplete(response->getResponseCode(), response->moveBody(), response->getRedirectLocation(), depth);
+		onDownloadComplete(std::move(download));
 	});
 }
 
-void Update::onDownloadComplete(int responseCode, Bytes bytes, String redirect, int depth)
+void Update::onDownloadComplete(std::optional<WebClient::DownloadedFile> download)
 {
 	downloading = false;
-	if (responseCode == 301 && depth < 3) {
-		download(redirect, depth + 1);
-		return;
-	} else if (responseCode != 200) {
-		downloading = false;
-		onError("HTTP Error " + toString(responseCode) + ": " + info.downloadURL);
+	if (!download) {
+		onError("Unable to download " + info.downloadURL);
 		return;
 	}
 
 	latestProgress = {};
 	showMessage("Checking file...");
 
-	extractFuture = Concurrent::execute([=, bytes = std::move(bytes)]() mutable
+	extractFuture = Concurrent::execute([=, path = std::move(download->path)]()
 	{
-		if (isValidSignature(bytes)) {
-			extract(std::move(bytes));
+		if (isValidSignature(path)) {
+			extract(path);
 		} else {
+			// Could also be a resumed download which changed on the server, so don't keep it around
+			std::error_code ec;
+			std::filesystem::remove(path.getString().cppStr(), ec);
 			Concurrent::execute(Executors::getMainUpdateThread(), [=]()
 			{
 				showMessage("Invalid signature, unable to auto-update.");
@@ -95,46 +94,36 @@ void Update::onDownloadComplete(int responseCode, Bytes bytes, String redirect,
 	});
 }
 
-void Update::extract(Bytes bytes)
+void Update::extract(const Path& archivePath)
 {
 	Concurrent::execute(Executors::getMainUpdateThread(), [=] ()
 	{
 		showMessage("Extracting...");
 	});
 
-	ZipFile zip;
-	bool success = zip.open(std::move(bytes));
-	if (!success) {
-		onError("Invalid file.");
-		return;
-	}
-
-	size_t totalSize = 0;
-	const auto n = zip.getNumFiles();
-	for (size_t i = 0; i < n; ++i) {
-		totalSize += zip.getFileSize(i);
-	}
-
 	const auto rootPath = parent.getHalleyAPI().core->getEnvironment().getProgramPath() / ".." / "tmp";
 
-	size_t runningTotal = 0;
-	for (size_t i = 0; i < n; ++i) {
-		const auto name = zip.getFileName(i);
-		auto fileBytes = zip.extractFile(i);
-		if (fileBytes.empty()) {
-			continue;
+	auto weakThis = weak_from_this();
+	ZipExtractor extractor(archivePath, rootPath);
+	extractor.setProgressCallback([weakThis] (uint64_t cur, uint64_t total) -> bool
+	{
+		auto ptr = weakThis.lock();
+		if (ptr) {
+			Concurrent::execute(Executors::getMainUpdateThread(), [=] ()
+			{
+				std::dynamic_pointer_cast<Update>(ptr)->updateExtractProgress(cur, total);
+			});
 		}
+		return !!ptr;
+	});
 
-		updateExtractProgress(runningTotal + fileBytes.size() / 2, totalSize);
-
-		const auto path = rootPath / name;
-		const auto parentPath = path.parentPath().getString().cppStr();
-		std::error_code ec;
-		std::filesystem::create_directories(parentPath, ec);
-		Path::writeFile(path, fileBytes);
-
-		runningTotal += fileBytes.size();
-		updateExtractProgress(runningTotal, totalSize);
+	if (!extractor.extract()) {
+		const auto name = extractor.getFailedEntry();
+		Concurrent::execute(Executors::getMainUpdateThread(), [=] ()
+		{
+			onError(name.isEmpty() ? String("Invalid file.") : "Unable to extract " + name);
+		});
+		return;
 	}
 
 	runUpdate();
@@ -188,8 +177,7 @@ void Update::doUpdateProgress()
 	}
 }
 
-bool Update::isValidSignature(const Bytes& bytes)
+bool Update::isValidSignature(const Path& path)
 {
-	const auto publicKey = factory.getResources().get<BinaryFile>("binary/halley-launcher.pub");
-	return Cryptography::verifySignature(Cryptography::HashAlgorithm::SHA256, publicKey->getSpan(), info.signature.byte_span(), bytes.byte_span());
+	return LauncherSignature::verifyFile(factory.getResources(), info.signature.byte_span(), path);
 }
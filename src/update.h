@@ -3,6 +3,7 @@
 #include <halley.hpp>
 
 #include "new_version_info.h"
+#include "web_client.h"
 
 class LauncherSettings;
 
@@ -25,15 +26,15 @@ namespace Halley {
         NewVersionInfo info;
 
         bool downloading = false;
-		Future<std::unique_ptr<HTTPResponse>> downloadFuture;
+		Future<std::optional<WebClient::DownloadedFile>> downloadFuture;
         Future<void> extractFuture;
 
         std::optional<std::pair<uint64_t, uint64_t>> latestProgress;
 
-        void download(const String& url, int depth = 0);
-        void onDownloadComplete(int responseCode, Bytes bytes, String redirect, int depth);
+        void download(const String& url);
+        void onDownloadComplete(std::optional<WebClient::DownloadedFile> download);
 
-        void extract(Bytes bytes);
+        void extract(const Path& archivePath);
 
         void runUpdate();
 
@@ -44,6 +45,6 @@ namespace Halley {
         void updateExtractProgress(uint64_t cur, uint64_t total);
         void doUpdateProgress();
 
-        bool isValidSignature(const Bytes& bytes);
+        bool isValidSignature(const Path& path);
     };
 }
@@ -2,54 +2,88 @@
 
 #include <filesystem>
 
+#include "file_downloader.h"
+#include "gzip_decoder.h"
 #include "launcher_settings.h"
+#include "project_data_parser.h"
+#include "sha256.h"
 
-WebClient::WebClient(WebAPI& webAPI, LauncherSettings& settings, Path projectsFolder)
+WebClient::WebClient(WebAPI& webAPI, LauncherSettings& settings, SessionTokenCache& sessionTokens, const ProjectDataFolders& projectDataFolders, Path projectsFolder, Path downloadsFolder)
 	: webAPI(webAPI)
 	, settings(settings)
+	, sessionTokens(sessionTokens)
+	, projectDataFolders(projectDataFolders)
 	, projectsFolder(std::move(projectsFolder))
+	, downloadsFolder(std::move(downloadsFolder))
 {
 }
 
-Future<bool> WebClient::updateProjectData(const String& url, const String& project, const String& username, const String& password)
+Future<WebClient::UpdateResult> WebClient::updateProjectData(const String& url, const String& project, const String& username, const String& password, bool deferred)
 {
-	return getProjectData(url, project, username, password).then(aliveFlag, Executors::getMainUpdateThread(), [=](std::optional<WebProjectData> projectData)
+	const auto path = getProjectPath(url, project);
+
+	// Anything still pending is older than what's about to be fetched, and would overwrite it if it was applied later
+	std::error_code ec;
+	std::filesystem::remove_all(getPendingPath(path).getString().cppStr(), ec);
+
+	return getProjectData(url, project, username, password, path, deferred).then(aliveFlag, Executors::getMainUpdateThread(), [=] (ProjectSync::Result result)
 	{
-		if (projectData) {
-			if (auto path = storeProjectData(url, project, *projectData)) {
-				ConfigNode params;
-				params["url"] = url;
-				params["project"] = project;
-				params["username"] = username;
-				params["password"] = password;
-				settings.addProject(*path, std::move(params));
-				return true;
-			}
+		if (result != ProjectSync::Result::Synced && result != ProjectSync::Result::UpToDate) {
+			return UpdateResult::Failed;
 		}
-		return false;
+
+		ConfigNode params;
+		params["url"] = url;
+		params["project"] = project;
+		params["username"] = username;
+		params["password"] = password;
+		settings.addProject(path, std::move(params));
+		return result == ProjectSync::Result::Synced ? UpdateResult::Updated : UpdateResult::UpToDate;
 	});
 }
 
-Future<std::optional<WebProjectData>> WebClient::getProjectData(const String& srcUrl, const String& project, const String& username, const String& password)
+Future<ProjectSync::Result> WebClient::getProjectData(const String& srcUrl, const String& project, const String& username, const String& password, const Path& localPath, bool deferred)
 {
 	auto url = srcUrl;
 	if (url.endsWith("/")) {
 		url = url.left(url.size() - 1);
 	}
 
-	Promise<std::optional<WebProjectData>> promise;
+	Promise<ProjectSync::Result> promise;
 	auto result = promise.getFuture();
 
-	login(url, project, username, password).then(aliveFlag, Executors::getCPU(), [=, promise = std::move(promise)](std::optional<String> token) mutable
+	if (const auto token = sessionTokens.get(url, project, username)) {
+		syncProject(url, project, *token, localPath, deferred).then(aliveFlag, Executors::getCPU(), [=, promise = std::move(promise)] (ProjectSync::Result syncResult) mutable
+		{
+			if (syncResult == ProjectSync::Result::Unauthorized) {
+				// Token was revoked or expired early, log in again
+				sessionTokens.invalidate(url, project, username);
+				loginAndSync(url, project, username, password, localPath, deferred, std::move(promise));
+			} else {
+				promise.setValue(syncResult);
+			}
+		});
+	} else {
+		loginAndSync(url, project, username, password, localPath, deferred, std::move(promise));
+	}
+
+	return result;
+}
+
+void WebClient::loginAndSync(const String& url, const String& project, const String& username, const String& password, const Path& localPath, bool deferred, Promise<ProjectSync::Result> promise)
+{
+	login(url, project, username, password).then(aliveFlag, Executors::getCPU(), [=, promise = std::move(promise)] (std::optional<String> token) mutable
 	{
-		if (token) {
-			onAddFromURLLogin(url, project, *token, std::move(promise));
-		} else {
-			promise.setValue(std::nullopt);
+		if (!token) {
+			promise.setValue(ProjectSync::Result::Failed);
+			return;
 		}
-	});
 
-	return result;
+		syncProject(url, project, *token, localPath, deferred).then(aliveFlag, Executors::getImmediate(), [promise = std::move(promise)] (ProjectSync::Result syncResult) mutable
+		{
+			promise.setValue(syncResult);
+		});
+	});
 }
 
 Future<std::optional<String>> WebClient::login(const String& baseURL, const String& project, const String& username, const String& password)
@@ -70,7 +104,11 @@ Future<std::optional<String>> WebClient::login(const String& baseURL, const Stri
 			return {};
 		} else if (response->getResponseCode() == 200) {
 			const auto responseBody = JSONConvert::parseConfig(response->getBody());
-			return responseBody["token"].asString("");
+			auto token = responseBody["token"].asString("");
+			if (!token.isEmpty()) {
+				sessionTokens.store(baseURL, project, username, token, responseBody["expiresIn"].asInt64(SessionTokenCache::defaultLifetime));
+			}
+			return token;
 		} else {
 			const auto responseBody = JSONConvert::parseConfig(response->getBody());
 			Logger::logError("Error attempting to login: " + responseBody["errorMsg"].asString(""));
@@ -79,74 +117,173 @@ Future<std::optional<String>> WebClient::login(const String& baseURL, const Stri
 	});
 }
 
-void WebClient::onAddFromURLLogin(const String& baseURL, const String& project, const String& token, Promise<std::optional<WebProjectData>> promise)
+Future<ProjectSync::Result> WebClient::syncProject(const String& baseURL, const String& project, const String& token, const Path& localPath, bool deferred)
+{
+	Promise<ProjectSync::Result> promise;
+	auto result = promise.getFuture();
+
+	auto pendingPath = deferred ? std::optional<Path>(getPendingPath(localPath)) : std::nullopt;
+	auto sync = std::make_shared<ProjectSync>(webAPI, baseURL, project, token, localPath, getManifestPath(localPath), std::move(pendingPath));
+	sync->run().then(aliveFlag, Executors::getCPU(), [=, promise = std::move(promise)] (ProjectSync::Result syncResult) mutable
+	{
+		if (syncResult == ProjectSync::Result::Unsupported) {
+			// Server doesn't support manifests, fetch the whole project instead
+			onAddFromURLLogin(baseURL, project, token, localPath, deferred, std::move(promise));
+		} else {
+			promise.setValue(syncResult);
+		}
+	});
+
+	return result;
+}
+
+void WebClient::onAddFromURLLogin(const String& baseURL, const String& project, const String& token, const Path& localPath, bool deferred, Promise<ProjectSync::Result> promise)
 {
 	const auto url = baseURL + "/external-project-properties/" + Encode::encodeURL(project);
-	auto request = webAPI.makeHTTPRequest(HTTPMethod::GET, url);
-	request->setHeader("Authorization", "Bearer " + token);
 
-	request->send().then(aliveFlag, Executors::getImmediate(), [promise = std::move(promise)] (std::unique_ptr<HTTPResponse> response) mutable
+	// Always written out in full, so files deleted or edited locally are restored.
+	// The payload goes to disk in chunks and is decompressed and parsed as each one arrives, so neither it nor the decoded
+	// files are held in memory.
+	const auto payloadPath = downloadsFolder / (localPath.getFilename().getString() + ".json");
+	const auto dstPath = deferred ? ProjectSync::getPendingFilesPath(getPendingPath(localPath)) : localPath;
+	auto parser = std::make_shared<ProjectDataParser>(dstPath);
+	auto decoder = std::make_shared<GZipDecoder>([parser] (gsl::span<const gsl::byte> data) -> bool
 	{
-		if (response->getResponseCode() == 200) {
-			const auto responseBody = JSONConvert::parseConfig(response->getBody());
-			promise.setValue(WebProjectData(responseBody));
+		return parser->feed(data);
+	}, true);
+	auto downloader = std::make_shared<FileDownloader>(webAPI, url, payloadPath);
+	downloader->setHeader("Authorization", "Bearer " + token);
+	downloader->setHeader("Accept-Encoding", "gzip");
+	downloader->setMaxConnections(settings.getDownloadConnections());
+	downloader->setResumable(false);
+	downloader->setStreamCallback([decoder] (gsl::span<const gsl::byte> data) -> bool
+	{
+		return decoder->feed(data);
+	});
+
+	downloader->start().then(aliveFlag, Executors::getCPU(), [=, promise = std::move(promise)] (bool ok) mutable
+	{
+		std::error_code ec;
+		std::filesystem::remove(payloadPath.getString().cppStr(), ec);
+
+		if (ok && decoder->finish() && parser->finish()) {
+			promise.setValue(ProjectSync::Result::Synced);
+			return;
+		}
+
+		if (deferred) {
+			// Only a complete download is kept for applying
+			std::filesystem::remove_all(getPendingPath(localPath).getString().cppStr(), ec);
+		}
+		if (downloader->getLastResponseCode() == 401) {
+			promise.setValue(ProjectSync::Result::Unauthorized);
 		} else {
-			promise.setValue(std::nullopt);
+			if (ok) {
+				Logger::logError("Unable to store project data to " + dstPath.getNativeString(false));
+			}
+			promise.setValue(ProjectSync::Result::Failed);
 		}
 	});
 }
 
-std::optional<Path> WebClient::storeProjectData(const String& url, const String& project, const WebProjectData& data)
+Path WebClient::getProjectPath(const String& url, const String& project) const
 {
 	Hash::Hasher hasher;
 	hasher.feed(url);
 	const auto hash = hasher.digest();
 
 	String projectId = project + "-" + toString(hash, 16);
-	Path basePath = projectsFolder / projectId;
+	return projectsFolder / projectId;
+}
 
-	for (const auto& file: data.files) {
-		const auto path = basePath / file.first;
-		//OS::get().createDirectories(path.parentPath());
-		std::error_code ec;
-		std::filesystem::create_directories(path.parentPath().getString().cppStr(), ec);
-		bool ok = Path::writeFile(path, file.second);
-		if (!ok) {
-			Logger::logError("Could not write " + toString(file.second.size()) + " bytes to " + path.getNativeString(false));
-			return std::nullopt;
-		}
-	}
+Path WebClient::getManifestPath(const Path& projectPath) const
+{
+	return projectDataFolders.getFolder(projectPath) / "manifest";
+}
 
-	return basePath;
+Path WebClient::getPendingPath(const Path& projectPath) const
+{
+	return projectDataFolders.getFolder(projectPath) / "pending_sync";
 }
 
-WebProjectData::WebProjectData(const ConfigNode& node)
+bool WebClient::applyPendingUpdate(const Path& projectPath) const
 {
-	if (node.hasKey("files")) {
-		for (const auto& fileNode: node["files"].asSequence()) {
-			const auto path = fileNode["path"].asString("");
-			const auto bytes = Encode::decodeBase64(fileNode["bytes"].asString(""));
-			if (!path.isEmpty() && !bytes.empty() && !path.contains("..")) {
-				files.emplace_back(path, bytes);
-			}
+	return ProjectSync::applyPending(projectPath, getManifestPath(projectPath), getPendingPath(projectPath));
+}
+
+Path WebClient::getPendingUpdatePath(const Path& projectPath) const
+{
+	return ProjectSync::getPendingFilesPath(getPendingPath(projectPath));
+}
+
+Future<std::optional<WebClient::DownloadedFile>> WebClient::downloadEditor(HalleyVersion version, std::function<bool(uint64_t, uint64_t)> callback, std::function<bool(gsl::span<const gsl::byte>)> streamCallback)
+{
+	const auto fileName = "halley-editor-" + version.toString() + ".zip";
+	return downloadSignedFile("https://update.halley.io/halley-editor-bins/" + fileName, fileName, std::move(callback), std::move(streamCallback));
+}
+
+Future<std::optional<WebClient::DownloadedFile>> WebClient::downloadEditorPatch(HalleyVersion from, HalleyVersion to, std::function<bool(uint64_t, uint64_t)> callback)
+{
+	// A missing signature also tells us there's no patch between these versions
+	const auto fileName = "halley-editor-" + from.toString() + "-to-" + to.toString() + ".patch";
+	return downloadSignedFile("https://update.halley.io/halley-editor-bins/" + fileName, fileName, std::move(callback), {});
+}
+
+Future<std::optional<WebClient::DownloadedFile>> WebClient::downloadSignedFile(const String& url, const String& fileName, std::function<bool(uint64_t, uint64_t)> callback, std::function<bool(gsl::span<const gsl::byte>)> streamCallback)
+{
+	Promise<std::optional<DownloadedFile>> promise;
+	auto result = promise.getFuture();
+
+	// Fetch the signature first, so it's ready to check against the digest as soon as the download is done.
+	// Nothing is downloaded without one, since there would be no way to trust it.
+	webAPI.makeHTTPRequest(HTTPMethod::GET, url + ".sig")->send().then(aliveFlag, Executors::getImmediate(), [=, promise = std::move(promise), callback = std::move(callback), streamCallback = std::move(streamCallback)] (std::unique_ptr<HTTPResponse> response) mutable
+	{
+		if (response->getResponseCode() != 200 || response->getBody().empty()) {
+			Logger::logWarning("No signature published for " + url + ", not downloading it.");
+			promise.setValue(std::nullopt);
+			return;
 		}
-	}
+
+		downloadFile(url, fileName, std::move(callback), std::move(streamCallback)).then(aliveFlag, Executors::getImmediate(), [promise = std::move(promise), signature = response->moveBody()] (std::optional<DownloadedFile> file) mutable
+		{
+			if (file) {
+				file->signature = std::move(signature);
+			}
+			promise.setValue(std::move(file));
+		});
+	});
+
+	return result;
 }
 
-Future<Bytes> WebClient::downloadEditor(HalleyVersion version, std::function<bool(uint64_t, uint64_t)> callback)
+Future<std::optional<WebClient::DownloadedFile>> WebClient::downloadFile(const String& url, const String& fileName, std::function<bool(uint64_t, uint64_t)> callback, std::function<bool(gsl::span<const gsl::byte>)> streamCallback)
 {
-	auto request = webAPI.makeHTTPRequest(HTTPMethod::GET, "https://update.halley.io/halley-editor-bins/halley-editor-" + version.toString() + ".zip");
+	auto path = downloadsFolder / fileName;
+	auto downloader = std::make_shared<FileDownloader>(webAPI, url, path);
+	downloader->setMaxConnections(settings.getDownloadConnections());
 
 	if (callback) {
-		request->setProgressCallback(std::move(callback));
+		downloader->setProgressCallback(std::move(callback));
+	}
+	if (streamCallback) {
+		downloader->setStreamCallback(std::move(streamCallback));
 	}
 
-	return request->send().then([] (std::unique_ptr<HTTPResponse> response) -> Bytes
+	return downloader->start().then([weakDownloader = std::weak_ptr<FileDownloader>(downloader), path = std::move(path)] (bool ok) -> std::optional<DownloadedFile>
 	{
-		if (response->getResponseCode() == 200) {
-			return response->getBody();
-		} else {
-			return {};
+		if (!ok) {
+			return std::nullopt;
+		}
+
+		// The digest is computed while downloading; only hash the file again if that couldn't be done
+		const auto downloader = weakDownloader.lock();
+		auto digest = downloader ? downloader->getDigest() : std::nullopt;
+		if (!digest) {
+			digest = SHA256Hasher::hashFile(path);
+			if (!digest) {
+				return std::nullopt;
+			}
 		}
+		return DownloadedFile{ path, std::move(*digest), {} };
 	});
 }
@@ -1,31 +1,56 @@
 #pragma once
 
 #include <halley.hpp>
+
+#include "project_data_folders.h"
+#include "project_sync.h"
+#include "session_token_cache.h"
 class LauncherSettings;
 using namespace Halley;
 
-struct WebProjectData {
-	Vector<std::pair<String, Bytes>> files;
-
-	WebProjectData() = default;
-	WebProjectData(const ConfigNode& node);
-};
-
 class WebClient {
 public:
-	WebClient(WebAPI& webAPI, LauncherSettings& settings, Path projectsFolder);
+	enum class UpdateResult {
+		Failed,
+		UpToDate,
+		Updated
+	};
+
+	struct DownloadedFile {
+		Path path;
+		Bytes sha256;
+		Bytes signature; // Always set for editors and patches, empty for files fetched with downloadFile
+	};
+
+	WebClient(WebAPI& webAPI, LauncherSettings& settings, SessionTokenCache& sessionTokens, const ProjectDataFolders& projectDataFolders, Path projectsFolder, Path downloadsFolder);
 
-	Future<bool> updateProjectData(const String& url, const String& project, const String& username, const String& password);
-	Future<Bytes> downloadEditor(HalleyVersion version, std::function<bool(uint64_t, uint64_t)> progressCallback = {});
+	// A deferred update leaves the project as it is, and keeps what it fetched pending until applyPendingUpdate is called
+	Future<UpdateResult> updateProjectData(const String& url, const String& project, const String& username, const String& password, bool deferred = false);
+	// Returns false if some of the update couldn't be moved into place (e.g. because the editor has files open)
+	bool applyPendingUpdate(const Path& projectPath) const;
+	// Where the files of a pending update can be read before they're applied
+	Path getPendingUpdatePath(const Path& projectPath) const;
+	// Editors and patches must be signed: they're only downloaded if the server publishes "<file>.sig" next to them.
+	Future<std::optional<DownloadedFile>> downloadEditor(HalleyVersion version, std::function<bool(uint64_t, uint64_t)> progressCallback = {}, std::function<bool(gsl::span<const gsl::byte>)> streamCallback = {});
+	Future<std::optional<DownloadedFile>> downloadEditorPatch(HalleyVersion from, HalleyVersion to, std::function<bool(uint64_t, uint64_t)> progressCallback = {});
+	Future<std::optional<DownloadedFile>> downloadFile(const String& url, const String& fileName, std::function<bool(uint64_t, uint64_t)> progressCallback = {}, std::function<bool(gsl::span<const gsl::byte>)> streamCallback = {});
 
 private:
 	WebAPI& webAPI;
 	LauncherSettings& settings;
+	SessionTokenCache& sessionTokens;
+	const ProjectDataFolders& projectDataFolders;
 	Path projectsFolder;
+	Path downloadsFolder;
 	AliveFlag aliveFlag;
 
-	Future<std::optional<WebProjectData>> getProjectData(const String& url, const String& project, const String& username, const String& password);
+	Future<ProjectSync::Result> getProjectData(const String& url, const String& project, const String& username, const String& password, const Path& localPath, bool deferred);
 	Future<std::optional<String>> login(const String& url, const String& project, const String& username, const String& password);
-	void onAddFromURLLogin(const String& url, const String& project, const String& token, Promise<std::optional<WebProjectData>> promise);
-	std::optional<Path> storeProjectData(const String& url, const String& project, const WebProjectData& data);
+	void loginAndSync(const String& url, const String& project, const String& username, const String& password, const Path& localPath, bool deferred, Promise<ProjectSync::Result> promise);
+	Future<ProjectSync::Result> syncProject(const String& url, const String& project, const String& token, const Path& localPath, bool deferred);
+	void onAddFromURLLogin(const String& url, const String& project, const String& token, const Path& localPath, bool deferred, Promise<ProjectSync::Result> promise);
+	Future<std::optional<DownloadedFile>> downloadSignedFile(const String& url, const String& fileName, std::function<bool(uint64_t, uint64_t)> progressCallback, std::function<bool(gsl::span<const gsl::byte>)> streamCallback);
+	Path getProjectPath(const String& url, const String& project) const;
+	Path getManifestPath(const Path& projectPath) const;
+	Path getPendingPath(const Path& projectPath) const;
 };
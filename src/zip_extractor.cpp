@@ -0,0 +1,298 @@
+#include "zip_extractor.h"
+
+#include <filesystem>
+#include <fstream>
+#include <set>
+#include <thread>
+
+#include "crc32.h"
+#include "file_writer.h"
+
+namespace {
+	std::optional<int64_t> getModifiedTime(const Path& path)
+	{
+		std::error_code ec;
+		const auto time = std::filesystem::last_write_time(path.getString().cppStr(), ec);
+		if (ec) {
+			return std::nullopt;
+		}
+		return static_cast<int64_t>(time.time_since_epoch().count());
+	}
+}
+
+ZipExtractor::ZipExtractor(Path archivePath, Path dstPath)
+	: archivePath(std::move(archivePath))
+	, dstPath(std::move(dstPath))
+	, maxThreads(std::max(1, static_cast<int>(std::thread::hardware_concurrency())))
+{
+}
+
+void ZipExtractor::setProgressCallback(ProgressCallback callback)
+{
+	progressCallback = std::move(callback);
+}
+
+void ZipExtractor::setMaxThreads(int threads)
+{
+	maxThreads = std::max(1, threads);
+}
+
+void ZipExtractor::setDifferential(Path path)
+{
+	indexPath = std::move(path);
+}
+
+bool ZipExtractor::extract()
+{
+	if (!readEntries()) {
+		return false;
+	}
+	if (!createDirectories()) {
+		return false;
+	}
+	if (!reportProgress(0)) {
+		return false;
+	}
+	if (indexPath) {
+		loadIndex();
+	}
+
+	runWorkers(std::min(static_cast<size_t>(maxThreads), entries.size()));
+
+	// Saved even after a failure, so whatever was verified doesn't have to be checked again
+	if (indexPath) {
+		saveIndex();
+	}
+
+	return !failed;
+}
+
+const String& ZipExtractor::getFailedEntry() const
+{
+	return failedEntry;
+}
+
+size_t ZipExtractor::getNumFilesSkipped() const
+{
+	return numFilesSkipped;
+}
+
+bool ZipExtractor::readEntries()
+{
+	ZipReader reader;
+	if (!reader.open(archivePath)) {
+		return false;
+	}
+
+	for (const auto& entry: reader.getEntries()) {
+		if (!ZipReader::isSafeName(entry.name)) {
+			Logger::logError("Invalid entry name in " + archivePath.getString() + ": " + entry.name);
+			failedEntry = entry.name;
+			return false;
+		}
+		if (!entry.isDirectory()) {
+			totalSize += entry.size;
+			entries.push_back(entry);
+		}
+	}
+
+	// Largest first, so one big file doesn't end up being the last thing left running
+	std::stable_sort(entries.begin(), entries.end(), [] (const ZipReader::Entry& a, const ZipReader::Entry& b)
+	{
+		return a.size > b.size;
+	});
+	return true;
+}
+
+bool ZipExtractor::createDirectories() const
+{
+	std::set<std::string> dirs;
+	for (const auto& entry: entries) {
+		dirs.insert((dstPath / entry.name).parentPath().getString().cppStr());
+	}
+
+	for (const auto& dir: dirs) {
+		std::error_code ec;
+		std::filesystem::create_directories(dir, ec);
+		if (ec) {
+			Logger::logError("Unable to create directory " + String(dir));
+			return false;
+		}
+	}
+	return true;
+}
+
+void ZipExtractor::runWorkers(size_t numWorkers)
+{
+	// The calling thread works too, so a single-threaded extraction doesn't schedule anything
+	auto workers = std::make_shared<Workers>();
+	for (size_t i = 1; i < numWorkers; ++i) {
+		Concurrent::execute(Executors::getCPU(), [this, workers] ()
+		{
+			{
+				auto lock = std::unique_lock(workers->mutex);
+				if (!workers->accepting) {
+					return;
+				}
+				++workers->running;
+			}
+
+			runWorker();
+
+			auto lock = std::unique_lock(workers->mutex);
+			--workers->running;
+			workers->finished.notify_all();
+		});
+	}
+	runWorker();
+
+	// Every entry has been claimed by now, so only wait for the workers still extracting theirs. Any that haven't started
+	// (e.g. because this is running on the CPU executors too) will find nothing to do and must not touch this extractor.
+	auto lock = std::unique_lock(workers->mutex);
+	workers->accepting = false;
+	workers->finished.wait(lock, [&] () { return workers->running == 0; });
+}
+
+void ZipExtractor::runWorker()
+{
+	ZipReader reader;
+	if (!reader.open(archivePath)) {
+		fail("");
+		return;
+	}
+	FileWriter writer;
+
+	while (!failed) {
+		const auto idx = nextEntry++;
+		if (idx >= entries.size()) {
+			break;
+		}
+
+		const auto& entry = entries[idx];
+		if (indexPath && isUnchanged(entry)) {
+			++numFilesSkipped;
+		} else if (!extractEntry(reader, writer, entry)) {
+			fail(entry.name);
+			break;
+		}
+
+		if (indexPath) {
+			addToIndex(entry);
+		}
+		if (!reportProgress(entry.size)) {
+			fail("");
+			break;
+		}
+	}
+}
+
+bool ZipExtractor::extractEntry(ZipReader& reader, FileWriter& writer, const ZipReader::Entry& entry)
+{
+	if (!writer.open(dstPath / entry.name, entry.size)) {
+		return false;
+	}
+
+	const bool ok = reader.extract(entry, [&] (gsl::span<const gsl::byte> data) -> bool
+	{
+		return writer.write(data);
+	});
+	return writer.close() && ok;
+}
+
+bool ZipExtractor::isUnchanged(const ZipReader::Entry& entry)
+{
+	const auto path = dstPath / entry.name;
+	std::error_code ec;
+	const auto size = std::filesystem::file_size(path.getString().cppStr(), ec);
+	if (ec || size != entry.size) {
+		return false;
+	}
+
+	// Trust the index if the file hasn't been modified since it was recorded
+	const auto iter = index.find(entry.name);
+	if (iter != index.end() && iter->second.size == entry.size && iter->second.crc == entry.crc && iter->second.modified == getModifiedTime(path)) {
+		return true;
+	}
+
+	std::ifstream file(path.getString().cppStr(), std::ios::binary);
+	if (!file) {
+		return false;
+	}
+	CRC32 crc;
+	Vector<char> block(64 * 1024);
+	while (file) {
+		file.read(block.data(), static_cast<std::streamsize>(block.size()));
+		crc.feed(gsl::as_bytes(gsl::span<const char>(block.data(), static_cast<size_t>(file.gcount()))));
+	}
+	return crc.get() == entry.crc;
+}
+
+void ZipExtractor::addToIndex(const ZipReader::Entry& entry)
+{
+	const auto modified = getModifiedTime(dstPath / entry.name);
+	if (!modified) {
+		return;
+	}
+
+	auto lock = std::unique_lock(mutex);
+	newIndex[entry.name] = IndexEntry{ entry.size, entry.crc, *modified };
+}
+
+bool ZipExtractor::reportProgress(uint64_t extracted)
+{
+	auto lock = std::unique_lock(mutex);
+	totalExtracted += extracted;
+	return !progressCallback || progressCallback(totalExtracted, totalSize);
+}
+
+void ZipExtractor::fail(const String& entry)
+{
+	auto lock = std::unique_lock(mutex);
+	if (!failed) {
+		failedEntry = entry;
+		failed = true;
+	}
+}
+
+void ZipExtractor::loadIndex()
+{
+	const auto bytes = Path::readFile(*indexPath);
+	if (bytes.empty()) {
+		return;
+	}
+
+	const auto indexFile = Deserializer::fromBytes<ConfigFile>(bytes);
+	for (const auto& [name, node]: indexFile.getRoot()["files"].asMap()) {
+		IndexEntry entry;
+		entry.size = static_cast<uint64_t>(node["size"].asInt64(0));
+		entry.crc = static_cast<uint32_t>(node["crc"].asInt64(0));
+		entry.modified = node["modified"].asInt64(0);
+		index[name] = entry;
+	}
+}
+
+void ZipExtractor::saveIndex() const
+{
+	// A failed or aborted extraction didn't get to every entry, so the previous records are kept for the ones it didn't reach.
+	// Any file it did touch has a new modification time, so a stale record for it won't be trusted.
+	auto merged = failed ? index : HashMap<String, IndexEntry>();
+	for (const auto& [name, entry]: newIndex) {
+		merged[name] = entry;
+	}
+
+	ConfigNode::MapType files;
+	for (const auto& [name, entry]: merged) {
+		ConfigNode::MapType node;
+		node["size"] = static_cast<int64_t>(entry.size);
+		node["crc"] = static_cast<int64_t>(entry.crc);
+		node["modified"] = entry.modified;
+		files[name] = std::move(node);
+	}
+
+	ConfigFile indexFile;
+	indexFile.getRoot() = ConfigNode::MapType();
+	indexFile.getRoot()["files"] = std::move(files);
+	std::error_code ec;
+	std::filesystem::create_directories(indexPath->parentPath().getString().cppStr(), ec);
+	Path::writeFile(*indexPath, Serializer::toBytes(indexFile));
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <halley.hpp>
+
+#include <condition_variable>
+
+#include "zip_reader.h"
+class FileWriter;
+using namespace Halley;
+
+// Extracts a zip archive to a folder, spreading the entries across tasks on the CPU executors.
+// Each worker opens its own view of the archive, so entries are inflated and written in parallel. The calling thread works
+// too, and extract() doesn't wait on workers which haven't started by the time it runs out of entries, so it's safe to call from a task.
+// The directory tree is created up front, and progress is reported as the total of bytes written by all workers.
+// In differential mode, files already on disk which match the entry's size and CRC are left alone. A checksum index
+// is kept at the given path, so files which haven't been touched since the last extraction don't need to be read back.
+class ZipExtractor {
+public:
+	// Called from worker threads, but never concurrently. Return false to abort.
+	using ProgressCallback = std::function<bool(uint64_t, uint64_t)>;
+
+	ZipExtractor(Path archivePath, Path dstPath);
+
+	void setProgressCallback(ProgressCallback callback);
+	void setMaxThreads(int threads);
+	void setDifferential(Path indexPath);
+
+	bool extract();
+
+	// Name of the entry that failed to extract or had an unsafe name, or empty if the archive couldn't be read or the extraction was aborted
+	const String& getFailedEntry() const;
+	size_t getNumFilesSkipped() const;
+
+private:
+	struct IndexEntry {
+		uint64_t size = 0;
+		uint32_t crc = 0;
+		int64_t modified = 0;
+	};
+
+	// Shared with the worker tasks, which may only get to run after extract() has returned
+	struct Workers {
+		std::mutex mutex;
+		std::condition_variable finished;
+		bool accepting = true;
+		int running = 0;
+	};
+
+	Path archivePath;
+	Path dstPath;
+	ProgressCallback progressCallback;
+	int maxThreads;
+	std::optional<Path> indexPath;
+
+	Vector<ZipReader::Entry> entries;
+	uint64_t totalSize = 0;
+	HashMap<String, IndexEntry> index;
+
+	std::atomic<size_t> nextEntry = 0;
+	std::atomic<bool> failed = false;
+	std::atomic<size_t> numFilesSkipped = 0;
+	std::mutex mutex;
+	uint64_t totalExtracted = 0;
+	String failedEntry;
+	HashMap<String, IndexEntry> newIndex;
+
+	bool readEntries();
+	bool createDirectories() const;
+	void runWorkers(size_t numWorkers);
+	void runWorker();
+	bool extractEntry(ZipReader& reader, FileWriter& writer, const ZipReader::Entry& entry);
+	bool isUnchanged(const ZipReader::Entry& entry);
+	void addToIndex(const ZipReader::Entry& entry);
+	bool reportProgress(uint64_t extracted);
+	void fail(const String& entry);
+
+	void loadIndex();
+	void saveIndex() const;
+};
@@ -0,0 +1,286 @@
+#include "zip_reader.h"
+
+#include "crc32.h"
+
+namespace {
+	constexpr uint32_t localHeaderSignature = 0x04034b50;
+	constexpr uint32_t centralHeaderSignature = 0x02014b50;
+	constexpr uint32_t endOfCentralDirSignature = 0x06054b50;
+	constexpr uint32_t zip64EndOfCentralDirSignature = 0x06064b50;
+	constexpr uint32_t zip64LocatorSignature = 0x07064b50;
+
+	constexpr size_t localHeaderSize = 30;
+	constexpr size_t centralHeaderSize = 46;
+	constexpr size_t endOfCentralDirSize = 22;
+	constexpr size_t zip64EndOfCentralDirSize = 56;
+	constexpr size_t zip64LocatorSize = 20;
+	constexpr size_t maxCommentSize = 0xFFFF;
+
+	constexpr uint16_t flagEncrypted = 0x01;
+	constexpr uint16_t methodStored = 0;
+	constexpr uint16_t methodDeflate = 8;
+
+	uint16_t readLE16(const uint8_t* data)
+	{
+		return static_cast<uint16_t>(data[0] | (data[1] << 8));
+	}
+
+	uint32_t readLE32(const uint8_t* data)
+	{
+		return uint32_t(data[0]) | (uint32_t(data[1]) << 8) | (uint32_t(data[2]) << 16) | (uint32_t(data[3]) << 24);
+	}
+
+	uint64_t readLE64(const uint8_t* data)
+	{
+		return uint64_t(readLE32(data)) | (uint64_t(readLE32(data + 4)) << 32);
+	}
+}
+
+bool ZipReader::Entry::isDirectory() const
+{
+	return name.endsWith("/");
+}
+
+bool ZipReader::isSafeName(const String& name)
+{
+	if (name.isEmpty() || name.startsWith("/") || name.startsWith("\\") || name.contains(":")) {
+		return false;
+	}
+	for (const auto& part: name.replaceAll("\\", "/").split('/')) {
+		if (part == "..") {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool ZipReader::open(const Path& path)
+{
+	entries.clear();
+
+	// Prefer mapping the archive, so only the pages holding the central directory and the entries being read are ever loaded.
+	// If it can't be mapped (e.g. no address space left on 32-bit), read through a file stream instead.
+	if (mappedFile.open(path)) {
+		fileSize = mappedFile.getSpan().size();
+	} else {
+		file.open(path.getString().cppStr(), std::ios::binary | std::ios::ate);
+		if (!file) {
+			return false;
+		}
+		fileSize = static_cast<uint64_t>(file.tellg());
+	}
+
+	if (!readCentralDirectory()) {
+		Logger::logError("Invalid zip file: " + path.getNativeString(false));
+		mappedFile.close();
+		file.close();
+		return false;
+	}
+	return true;
+}
+
+const Vector<ZipReader::Entry>& ZipReader::getEntries() const
+{
+	return entries;
+}
+
+bool ZipReader::extract(const Entry& entry, const OutputCallback& output)
+{
+	if ((entry.flags & flagEncrypted) || (entry.method != methodStored && entry.method != methodDeflate)) {
+		Logger::logError("Unsupported zip entry: " + entry.name);
+		return false;
+	}
+
+	// The local header repeats the name, but its extra field can differ in length from the central directory's
+	std::array<uint8_t, localHeaderSize> header;
+	if (!read(entry.localHeaderOffset, header.data(), header.size()) || readLE32(header.data()) != localHeaderSignature) {
+		return false;
+	}
+	uint64_t pos = entry.localHeaderOffset + localHeaderSize + readLE16(header.data() + 26) + readLE16(header.data() + 28);
+	if (pos > fileSize || entry.compressedSize > fileSize - pos) {
+		return false;
+	}
+
+	CRC32 crc;
+	uint64_t written = 0;
+	auto onOutput = [&] (gsl::span<const gsl::byte> data) -> bool
+	{
+		crc.feed(data);
+		written += data.size();
+		return !output || output(data);
+	};
+
+	std::unique_ptr<Inflater> inflater;
+	if (entry.method == methodDeflate) {
+		inflater = std::make_unique<Inflater>(onOutput);
+	}
+
+	// Mapped archives are fed straight from the mapping, in blocks so the inflater's input buffer stays small
+	Vector<uint8_t> block;
+	if (!mappedFile.isOpen()) {
+		block.resize(static_cast<size_t>(std::min<uint64_t>(readBlockSize, std::max<uint64_t>(entry.compressedSize, 1))));
+	}
+	for (uint64_t remaining = entry.compressedSize; remaining > 0; ) {
+		const auto n = static_cast<size_t>(std::min<uint64_t>(remaining, readBlockSize));
+		gsl::span<const gsl::byte> data;
+		if (mappedFile.isOpen()) {
+			data = mappedFile.getSpan().subspan(static_cast<size_t>(pos), n);
+		} else {
+			if (!read(pos, block.data(), n)) {
+				return false;
+			}
+			data = gsl::as_bytes(gsl::span<const uint8_t>(block.data(), n));
+		}
+		if (inflater ? !inflater->feed(data) : !onOutput(data)) {
+			return false;
+		}
+		pos += n;
+		remaining -= n;
+	}
+
+	if (inflater && !inflater->isDone()) {
+		return false;
+	}
+	if (written != entry.size || crc.get() != entry.crc) {
+		Logger::logError("Checksum mismatch in zip entry: " + entry.name);
+		return false;
+	}
+	return true;
+}
+
+std::optional<Bytes> ZipReader::extractBytes(const Entry& entry)
+{
+	// Sized up front from the central directory, so the buffer is allocated once and never grows
+	Bytes result(static_cast<size_t>(entry.size));
+	size_t pos = 0;
+	const bool ok = extract(entry, [&] (gsl::span<const gsl::byte> data) -> bool
+	{
+		if (pos + data.size() > result.size()) {
+			return false;
+		}
+		memcpy(result.data() + pos, data.data(), data.size());
+		pos += data.size();
+		return true;
+	});
+
+	if (!ok) {
+		return std::nullopt;
+	}
+	return result;
+}
+
+bool ZipReader::readCentralDirectory()
+{
+	// The end of central directory record is at the end of the file, followed by a comment of up to 64k
+	const auto tailSize = static_cast<size_t>(std::min<uint64_t>(fileSize, endOfCentralDirSize + maxCommentSize));
+	Vector<uint8_t> tail(tailSize);
+	if (tailSize < endOfCentralDirSize || !read(fileSize - tailSize, tail.data(), tailSize)) {
+		return false;
+	}
+
+	std::optional<size_t> eocdPos;
+	for (size_t i = tailSize - endOfCentralDirSize + 1; i-- > 0; ) {
+		if (readLE32(tail.data() + i) == endOfCentralDirSignature) {
+			eocdPos = i;
+			break;
+		}
+	}
+	if (!eocdPos) {
+		return false;
+	}
+
+	const auto* eocd = tail.data() + *eocdPos;
+	uint64_t numEntries = readLE16(eocd + 10);
+	uint64_t dirSize = readLE32(eocd + 12);
+	uint64_t dirOffset = readLE32(eocd + 16);
+
+	if (numEntries == 0xFFFF || dirSize == 0xFFFFFFFF || dirOffset == 0xFFFFFFFF) {
+		// Zip64, the real values are in the zip64 end of central directory record
+		const auto eocdOffset = fileSize - tailSize + *eocdPos;
+		std::array<uint8_t, zip64LocatorSize> locator;
+		if (eocdOffset < zip64LocatorSize || !read(eocdOffset - zip64LocatorSize, locator.data(), locator.size()) || readLE32(locator.data()) != zip64LocatorSignature) {
+			return false;
+		}
+		std::array<uint8_t, zip64EndOfCentralDirSize> record;
+		if (!read(readLE64(locator.data() + 8), record.data(), record.size()) || readLE32(record.data()) != zip64EndOfCentralDirSignature) {
+			return false;
+		}
+		numEntries = readLE64(record.data() + 32);
+		dirSize = readLE64(record.data() + 40);
+		dirOffset = readLE64(record.data() + 48);
+	}
+
+	// Zip64 offsets and sizes are untrusted 64-bit values, so compare without adding them together, which could wrap
+	if (dirOffset > fileSize || dirSize > fileSize - dirOffset || numEntries > dirSize / centralHeaderSize) {
+		return false;
+	}
+
+	Vector<uint8_t> dir(static_cast<size_t>(dirSize));
+	if (!read(dirOffset, dir.data(), dir.size())) {
+		return false;
+	}
+
+	entries.reserve(static_cast<size_t>(numEntries));
+	size_t pos = 0;
+	for (uint64_t i = 0; i < numEntries; ++i) {
+		if (pos + centralHeaderSize > dir.size() || readLE32(dir.data() + pos) != centralHeaderSignature) {
+			return false;
+		}
+		const auto* header = dir.data() + pos;
+		const size_t nameLength = readLE16(header + 28);
+		const size_t extraLength = readLE16(header + 30);
+		const size_t commentLength = readLE16(header + 32);
+		if (pos + centralHeaderSize + nameLength + extraLength + commentLength > dir.size()) {
+			return false;
+		}
+
+		Entry entry;
+		entry.flags = readLE16(header + 8);
+		entry.method = readLE16(header + 10);
+		entry.crc = readLE32(header + 16);
+		entry.compressedSize = readLE32(header + 20);
+		entry.size = readLE32(header + 24);
+		entry.localHeaderOffset = readLE32(header + 42);
+		entry.name = String(reinterpret_cast<const char*>(header + centralHeaderSize), nameLength);
+
+		// Zip64 extra field only holds the values that didn't fit, in this order
+		const auto* extra = header + centralHeaderSize + nameLength;
+		for (size_t extraPos = 0; extraPos + 4 <= extraLength; ) {
+			const auto id = readLE16(extra + extraPos);
+			const size_t length = readLE16(extra + extraPos + 2);
+			if (extraPos + 4 + length > extraLength) {
+				break;
+			}
+			if (id == 0x0001) {
+				const auto* value = extra + extraPos + 4;
+				const auto* end = value + length;
+				for (auto* field: { &entry.size, &entry.compressedSize, &entry.localHeaderOffset }) {
+					if (*field == 0xFFFFFFFF && value + 8 <= end) {
+						*field = readLE64(value);
+						value += 8;
+					}
+				}
+			}
+			extraPos += 4 + length;
+		}
+
+		entries.push_back(std::move(entry));
+		pos += centralHeaderSize + nameLength + extraLength + commentLength;
+	}
+	return true;
+}
+
+bool ZipReader::read(uint64_t pos, void* dst, size_t size)
+{
+	if (pos > fileSize || size > fileSize - pos) {
+		return false;
+	}
+	if (mappedFile.isOpen()) {
+		memcpy(dst, mappedFile.getSpan().data() + pos, size);
+		return true;
+	}
+	file.clear();
+	file.seekg(static_cast<std::streamoff>(pos));
+	file.read(static_cast<char*>(dst), static_cast<std::streamsize>(size));
+	return !!file;
+}
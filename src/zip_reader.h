@@ -0,0 +1,50 @@
+#pragma once
+
+#include <halley.hpp>
+
+#include <fstream>
+
+#include "inflater.h"
+#include "mapped_file.h"
+using namespace Halley;
+
+// Reads a zip archive straight from disk, memory-mapped where possible.
+// Only the central directory is loaded when opening; entries are read and inflated on demand, and streamed to a callback.
+class ZipReader {
+public:
+	using OutputCallback = Inflater::OutputCallback;
+
+	struct Entry {
+		String name;
+		uint16_t flags = 0;
+		uint16_t method = 0;
+		uint32_t crc = 0;
+		uint64_t compressedSize = 0;
+		uint64_t size = 0;
+		uint64_t localHeaderOffset = 0;
+
+		bool isDirectory() const;
+	};
+
+	// False for names which would end up outside the folder they're extracted to (absolute paths, drive letters or ".." parts)
+	static bool isSafeName(const String& name);
+
+	bool open(const Path& path);
+
+	const Vector<Entry>& getEntries() const;
+
+	// Streams the uncompressed contents of an entry to the callback, and checks them against the entry's CRC
+	bool extract(const Entry& entry, const OutputCallback& output);
+	std::optional<Bytes> extractBytes(const Entry& entry);
+
+private:
+	constexpr static size_t readBlockSize = 64 * 1024;
+
+	MappedFile mappedFile;
+	std::ifstream file; // Only used if the archive couldn't be mapped
+	uint64_t fileSize = 0;
+	Vector<Entry> entries;
+
+	bool readCentralDirectory();
+	bool read(uint64_t pos, void* dst, size_t size);
+};
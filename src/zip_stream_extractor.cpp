@@ -0,0 +1,331 @@
+#include "zip_stream_extractor.h"
+
+#include <filesystem>
+
+#include "zip_reader.h"
+
+namespace {
+	constexpr uint32_t localHeaderSignature = 0x04034b50;
+	constexpr uint32_t centralHeaderSignature = 0x02014b50;
+	constexpr uint32_t endOfCentralDirSignature = 0x06054b50;
+	constexpr uint32_t descriptorSignature = 0x08074b50;
+
+	constexpr uint16_t flagEncrypted = 0x01;
+	constexpr uint16_t flagDescriptor = 0x08;
+
+	constexpr uint16_t methodStored = 0;
+	constexpr uint16_t methodDeflate = 8;
+
+	uint16_t readLE16(const uint8_t* data)
+	{
+		return static_cast<uint16_t>(data[0] | (data[1] << 8));
+	}
+
+	uint32_t readLE32(const uint8_t* data)
+	{
+		return uint32_t(data[0]) | (uint32_t(data[1]) << 8) | (uint32_t(data[2]) << 16) | (uint32_t(data[3]) << 24);
+	}
+
+	uint64_t readLE64(const uint8_t* data)
+	{
+		return uint64_t(readLE32(data)) | (uint64_t(readLE32(data + 4)) << 32);
+	}
+}
+
+bool ZipStreamExtractor::Entry::hasDescriptor() const
+{
+	return (flags & flagDescriptor) != 0;
+}
+
+ZipStreamExtractor::ZipStreamExtractor(Path dstPath)
+	: dstPath(std::move(dstPath))
+{
+}
+
+bool ZipStreamExtractor::feed(gsl::span<const gsl::byte> data)
+{
+	while (!data.empty()) {
+		size_t consumed = 0;
+		switch (state) {
+		case State::Header:
+			consumed = feedHeader(data);
+			break;
+		case State::Data:
+			consumed = feedData(data);
+			break;
+		case State::Descriptor:
+			consumed = feedDescriptor(data);
+			break;
+		case State::Done:
+			return true;
+		case State::Error:
+			return false;
+		}
+		data = data.subspan(consumed);
+	}
+	return state != State::Error;
+}
+
+bool ZipStreamExtractor::isDone() const
+{
+	return state == State::Done;
+}
+
+size_t ZipStreamExtractor::getNumFilesWritten() const
+{
+	return numFilesWritten;
+}
+
+size_t ZipStreamExtractor::feedHeader(gsl::span<const gsl::byte> data)
+{
+	size_t consumed = fillBuffer(data, 4);
+	if (buffer.size() < 4) {
+		return consumed;
+	}
+
+	const auto signature = readLE32(buffer.data());
+	if (signature == centralHeaderSignature || signature == endOfCentralDirSignature) {
+		// Everything after the last entry is the central directory, which we don't need
+		state = State::Done;
+		return data.size();
+	}
+	if (signature != localHeaderSignature) {
+		fail("Unexpected data in zip stream");
+		return data.size();
+	}
+
+	consumed += fillBuffer(data.subspan(consumed), localHeaderSize);
+	if (buffer.size() < localHeaderSize) {
+		return consumed;
+	}
+	const size_t nameLength = readLE16(buffer.data() + 26);
+	const size_t extraLength = readLE16(buffer.data() + 28);
+	consumed += fillBuffer(data.subspan(consumed), localHeaderSize + nameLength + extraLength);
+	if (buffer.size() < localHeaderSize + nameLength + extraLength) {
+		return consumed;
+	}
+
+	entry = Entry();
+	entry.flags = readLE16(buffer.data() + 6);
+	entry.method = readLE16(buffer.data() + 8);
+	entry.crc = readLE32(buffer.data() + 14);
+	entry.compressedSize = readLE32(buffer.data() + 18);
+	entry.size = readLE32(buffer.data() + 22);
+	entry.name = String(reinterpret_cast<const char*>(buffer.data() + localHeaderSize), nameLength);
+
+	// Zip64 entries keep their real sizes in an extra field
+	const auto* extra = buffer.data() + localHeaderSize + nameLength;
+	for (size_t pos = 0; pos + 4 <= extraLength; ) {
+		const auto id = readLE16(extra + pos);
+		const size_t length = readLE16(extra + pos + 2);
+		if (id == 0x0001 && length >= 16 && pos + 4 + length <= extraLength) {
+			entry.size = readLE64(extra + pos + 4);
+			entry.compressedSize = readLE64(extra + pos + 12);
+			entry.zip64 = true;
+		}
+		pos += 4 + length;
+	}
+	buffer.clear();
+
+	if (!startEntry()) {
+		return data.size();
+	}
+	return consumed;
+}
+
+size_t ZipStreamExtractor::feedData(gsl::span<const gsl::byte> data)
+{
+	if (entry.method == methodStored) {
+		const auto n = static_cast<size_t>(std::min<uint64_t>(compressedRemaining, data.size()));
+		if (!writeOutput(data.subspan(0, n))) {
+			return data.size();
+		}
+		compressedRemaining -= n;
+		if (compressedRemaining == 0) {
+			endData();
+		}
+		return n;
+	}
+
+	if (!entry.hasDescriptor()) {
+		const auto n = static_cast<size_t>(std::min<uint64_t>(compressedRemaining, data.size()));
+		if (!inflater->feed(data.subspan(0, n))) {
+			fail("Corrupt data in " + entry.name);
+			return data.size();
+		}
+		compressedRemaining -= n;
+		if (compressedRemaining == 0) {
+			if (!inflater->isDone()) {
+				fail("Truncated data in " + entry.name);
+				return data.size();
+			}
+			endData();
+		}
+		return n;
+	}
+
+	// The compressed size isn't known up front, so feed in small slices and let the inflater find the end of the stream.
+	// Whatever it didn't consume belongs to the data descriptor and the entries after it.
+	const auto slice = data.subspan(0, std::min(data.size(), descriptorSliceSize));
+	if (!inflater->feed(slice)) {
+		fail("Corrupt data in " + entry.name);
+		return data.size();
+	}
+	if (!inflater->isDone()) {
+		return slice.size();
+	}
+	const auto remaining = inflater->getRemainingInput().size();
+	if (remaining > slice.size()) {
+		fail("Unable to locate the end of " + entry.name);
+		return data.size();
+	}
+	endData();
+	return slice.size() - remaining;
+}
+
+size_t ZipStreamExtractor::feedDescriptor(gsl::span<const gsl::byte> data)
+{
+	size_t consumed = fillBuffer(data, 4);
+	if (buffer.size() < 4) {
+		return consumed;
+	}
+
+	const size_t signatureSize = readLE32(buffer.data()) == descriptorSignature ? 4 : 0;
+	const size_t descriptorSize = signatureSize + (entry.zip64 ? 20 : 12);
+	consumed += fillBuffer(data.subspan(consumed), descriptorSize);
+	if (buffer.size() < descriptorSize) {
+		return consumed;
+	}
+
+	const auto* descriptor = buffer.data() + signatureSize;
+	entry.crc = readLE32(descriptor);
+	entry.size = entry.zip64 ? readLE64(descriptor + 12) : readLE32(descriptor + 8);
+	buffer.clear();
+
+	if (!endEntry()) {
+		return data.size();
+	}
+	return consumed;
+}
+
+size_t ZipStreamExtractor::fillBuffer(gsl::span<const gsl::byte> data, size_t size)
+{
+	if (buffer.size() >= size) {
+		return 0;
+	}
+	const auto n = std::min(size - buffer.size(), data.size());
+	const auto* src = reinterpret_cast<const uint8_t*>(data.data());
+	buffer.insert(buffer.end(), src, src + n);
+	return n;
+}
+
+bool ZipStreamExtractor::startEntry()
+{
+	if (entry.flags & flagEncrypted) {
+		fail("Encrypted entry in zip stream: " + entry.name);
+		return false;
+	}
+	if (entry.method != methodStored && entry.method != methodDeflate) {
+		fail("Unsupported compression method in zip stream: " + entry.name);
+		return false;
+	}
+	if (entry.method == methodStored && entry.hasDescriptor()) {
+		fail("Unable to stream stored entry without a size: " + entry.name);
+		return false;
+	}
+	if (!ZipReader::isSafeName(entry.name)) {
+		fail("Invalid entry name in zip stream: " + entry.name);
+		return false;
+	}
+
+	const auto path = dstPath / entry.name;
+	const auto isDir = entry.name.endsWith("/");
+	const auto dir = isDir ? path : path.parentPath();
+	if (createdDirs.find(dir.getString()) == createdDirs.end()) {
+		std::error_code ec;
+		std::filesystem::create_directories(dir.getString().cppStr(), ec);
+		createdDirs.insert(dir.getString());
+	}
+
+	if (!isDir) {
+		if (!file.open(path, entry.size)) {
+			fail("Unable to write " + path.getNativeString(false));
+			return false;
+		}
+	}
+
+	crc = CRC32();
+	written = 0;
+	compressedRemaining = entry.compressedSize;
+	if (entry.method == methodDeflate) {
+		inflater = std::make_unique<Inflater>([this] (gsl::span<const gsl::byte> output) -> bool
+		{
+			return writeOutput(output);
+		});
+	}
+
+	state = State::Data;
+	if (compressedRemaining == 0 && !entry.hasDescriptor()) {
+		// Nothing to read, e.g. a directory or an empty file
+		if (entry.method == methodDeflate) {
+			fail("Truncated data in " + entry.name);
+			return false;
+		}
+		endData();
+		return state != State::Error;
+	}
+	return true;
+}
+
+bool ZipStreamExtractor::writeOutput(gsl::span<const gsl::byte> data)
+{
+	crc.feed(data);
+	written += data.size();
+	if (file.isOpen()) {
+		if (!file.write(data)) {
+			fail("Unable to write " + (dstPath / entry.name).getNativeString(false));
+			return false;
+		}
+	}
+	return true;
+}
+
+void ZipStreamExtractor::endData()
+{
+	inflater.reset();
+	if (entry.hasDescriptor()) {
+		state = State::Descriptor;
+	} else {
+		endEntry();
+	}
+}
+
+bool ZipStreamExtractor::endEntry()
+{
+	if (written != entry.size || crc.get() != entry.crc) {
+		fail("Checksum mismatch in zip stream: " + entry.name);
+		return false;
+	}
+
+	if (file.isOpen()) {
+		if (!file.close()) {
+			fail("Unable to write " + (dstPath / entry.name).getNativeString(false));
+			return false;
+		}
+		++numFilesWritten;
+	}
+
+	state = State::Header;
+	return true;
+}
+
+void ZipStreamExtractor::fail(const String& error)
+{
+	if (state != State::Error) {
+		Logger::logWarning(error);
+		state = State::Error;
+	}
+	if (file.isOpen()) {
+		file.close();
+	}
+}
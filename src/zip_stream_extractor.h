@@ -0,0 +1,74 @@
+#pragma once
+
+#include <halley.hpp>
+
+#include <set>
+
+#include "crc32.h"
+#include "file_writer.h"
+#include "inflater.h"
+using namespace Halley;
+
+// Extracts a zip archive while it's still arriving, by walking the local file headers in order.
+// Bytes must be fed in order from the start of the archive; each entry is inflated and written as soon as its data is in.
+// Archives this can't handle (e.g. stored entries with a trailing data descriptor) make it fail, so the caller can fall back to
+// extracting the complete archive through its central directory.
+class ZipStreamExtractor {
+public:
+	ZipStreamExtractor(Path dstPath);
+
+	// Returns false once extraction has failed, after which further data is ignored
+	bool feed(gsl::span<const gsl::byte> data);
+
+	// True if the whole archive was seen and every entry was extracted
+	bool isDone() const;
+	size_t getNumFilesWritten() const;
+
+private:
+	constexpr static size_t localHeaderSize = 30;
+	constexpr static size_t descriptorSliceSize = 64 * 1024;
+
+	enum class State {
+		Header,
+		Data,
+		Descriptor,
+		Done,
+		Error
+	};
+
+	struct Entry {
+		String name;
+		uint16_t flags = 0;
+		uint16_t method = 0;
+		uint32_t crc = 0;
+		uint64_t compressedSize = 0;
+		uint64_t size = 0;
+		bool zip64 = false;
+
+		bool hasDescriptor() const;
+	};
+
+	Path dstPath;
+	State state = State::Header;
+	Vector<uint8_t> buffer;
+
+	Entry entry;
+	uint64_t compressedRemaining = 0;
+	std::unique_ptr<Inflater> inflater;
+	CRC32 crc;
+	uint64_t written = 0;
+	FileWriter file;
+	std::set<String> createdDirs;
+	size_t numFilesWritten = 0;
+
+	size_t feedHeader(gsl::span<const gsl::byte> data);
+	size_t feedData(gsl::span<const gsl::byte> data);
+	size_t feedDescriptor(gsl::span<const gsl::byte> data);
+	size_t fillBuffer(gsl::span<const gsl::byte> data, size_t size);
+
+	bool startEntry();
+	bool writeOutput(gsl::span<const gsl::byte> data);
+	void endData();
+	bool endEntry();
+	void fail(const String& error);
+};
@@ -0,0 +1,230 @@
+#include "test_runner.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include "binary_diff.h"
+#include "crc32.h"
+#include "zip_extractor.h"
+#include "zip_reader.h"
+#include "zip_stream_extractor.h"
+
+// Every allocation in the test executable goes through here, so tests can check that large downloads are never held in memory.
+// Only the sizes are recorded: a copy of an archive shows up as an allocation at least as large as the archive.
+namespace {
+	std::atomic<size_t> thresholdSize = SIZE_MAX;
+	std::atomic<size_t> numLargeAllocations = 0;
+	std::atomic<size_t> largestAllocation = 0;
+
+	void recordAllocation(size_t size)
+	{
+		if (size >= thresholdSize) {
+			++numLargeAllocations;
+		}
+		size_t largest = largestAllocation;
+		while (size > largest && !largestAllocation.compare_exchange_weak(largest, size)) {
+		}
+	}
+
+	// Counts allocations of at least the given size made during its lifetime
+	class AllocationTracker {
+	public:
+		AllocationTracker(size_t threshold)
+		{
+			numLargeAllocations = 0;
+			largestAllocation = 0;
+			thresholdSize = threshold;
+		}
+
+		~AllocationTracker()
+		{
+			thresholdSize = SIZE_MAX;
+		}
+
+		size_t getNumLargeAllocations() const { return numLargeAllocations; }
+		size_t getLargestAllocation() const { return largestAllocation; }
+	};
+}
+
+void* operator new(size_t size)
+{
+	recordAllocation(size);
+	if (void* ptr = std::malloc(size == 0 ? 1 : size)) {
+		return ptr;
+	}
+	throw std::bad_alloc();
+}
+
+// Replaced too, so that every form of delete frees what this file allocated (e.g. std::stable_sort's temporary buffer)
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+	recordAllocation(size);
+	return std::malloc(size == 0 ? 1 : size);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete(void* ptr) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+	std::free(ptr);
+}
+
+namespace {
+	constexpr size_t payloadSize = 4 * 1024 * 1024;
+
+	Bytes makeRandom(size_t size, uint32_t seed)
+	{
+		Bytes result(size);
+		for (auto& b: result) {
+			seed = seed * 1664525u + 1013904223u;
+			b = static_cast<gsl::byte>(seed >> 24);
+		}
+		return result;
+	}
+
+	void writeLE(Bytes& dst, uint64_t value, size_t size)
+	{
+		for (size_t i = 0; i < size; ++i) {
+			dst.push_back(static_cast<gsl::byte>((value >> (8 * i)) & 0xFF));
+		}
+	}
+
+	// Single stored entry, so the archive is as large as its payload and can't be mistaken for any of the working buffers
+	Bytes makeStoredZip(const String& name, const Bytes& payload)
+	{
+		const auto crc = CRC32::compute(payload.byte_span());
+		const auto nameBytes = gsl::as_bytes(gsl::span<const char>(name.c_str(), name.size()));
+
+		Bytes result;
+		writeLE(result, 0x04034B50, 4);
+		for (const uint64_t value: { 20, 0, 0, 0, 0 }) {
+			writeLE(result, value, 2);
+		}
+		for (const uint64_t value: { uint64_t(crc), uint64_t(payload.size()), uint64_t(payload.size()) }) {
+			writeLE(result, value, 4);
+		}
+		writeLE(result, name.size(), 2);
+		writeLE(result, 0, 2);
+		result.insert(result.end(), nameBytes.begin(), nameBytes.end());
+		result.insert(result.end(), payload.begin(), payload.end());
+
+		const auto dirOffset = result.size();
+		writeLE(result, 0x02014B50, 4);
+		for (const uint64_t value: { 20, 20, 0, 0, 0, 0 }) {
+			writeLE(result, value, 2);
+		}
+		for (const uint64_t value: { uint64_t(crc), uint64_t(payload.size()), uint64_t(payload.size()) }) {
+			writeLE(result, value, 4);
+		}
+		for (const uint64_t value: { uint64_t(name.size()), uint64_t(0), uint64_t(0), uint64_t(0), uint64_t(0) }) {
+			writeLE(result, value, 2);
+		}
+		writeLE(result, 0, 4);
+		writeLE(result, 0, 4);
+		result.insert(result.end(), nameBytes.begin(), nameBytes.end());
+
+		const auto dirSize = result.size() - dirOffset;
+		writeLE(result, 0x06054B50, 4);
+		for (const uint64_t value: { 0, 0, 1, 1 }) {
+			writeLE(result, value, 2);
+		}
+		writeLE(result, dirSize, 4);
+		writeLE(result, dirOffset, 4);
+		writeLE(result, 0, 2);
+		return result;
+	}
+}
+
+LAUNCHER_TEST(installNeverCopiesTheArchive)
+{
+	const auto payload = makeRandom(payloadSize, 1);
+	const auto root = TestRunner::makeTempDir("allocation");
+	const auto archivePath = root / "editor.zip";
+	{
+		const auto archive = makeStoredZip("bin/editor", payload);
+		CHECK(Path::writeFile(archivePath, archive));
+
+		// As during a download, the archive arrives in blocks and is extracted as it goes
+		AllocationTracker tracker(payloadSize);
+		ZipStreamExtractor extractor(root / "streamed");
+		for (size_t pos = 0; pos < archive.size(); pos += 64 * 1024) {
+			CHECK(extractor.feed(archive.byte_span().subspan(pos, std::min<size_t>(64 * 1024, archive.size() - pos))));
+		}
+		CHECK(extractor.isDone());
+		CHECK(tracker.getNumLargeAllocations() == 0);
+	}
+	CHECK(Path::readFile(root / "streamed" / "bin" / "editor") == payload);
+
+	// From the downloaded file
+	for (const int threads: { 1, 4 }) {
+		const auto dst = root / ("extracted" + toString(threads));
+		{
+			AllocationTracker tracker(payloadSize);
+			ZipExtractor extractor(archivePath, dst);
+			extractor.setMaxThreads(threads);
+			CHECK(extractor.extract());
+			CHECK(tracker.getNumLargeAllocations() == 0);
+		}
+		CHECK(Path::readFile(dst / "bin" / "editor") == payload);
+	}
+}
+
+LAUNCHER_TEST(zipExtractBytesAllocatesOnce)
+{
+	const auto payload = makeRandom(payloadSize, 2);
+	const auto archivePath = TestRunner::makeTempDir("allocation") / "patch.zip";
+	CHECK(Path::writeFile(archivePath, makeStoredZip("diff", payload)));
+
+	ZipReader reader;
+	CHECK(reader.open(archivePath));
+	CHECK(reader.getEntries().size() == 1);
+	if (reader.getEntries().size() != 1) {
+		return;
+	}
+
+	std::optional<Bytes> result;
+	{
+		// The result buffer is the only allocation the size of the entry: it's never grown, and the archive is never loaded
+		AllocationTracker tracker(payloadSize);
+		result = reader.extractBytes(reader.getEntries()[0]);
+		CHECK(tracker.getNumLargeAllocations() == 1);
+		CHECK(tracker.getLargestAllocation() == payloadSize);
+	}
+	CHECK(result == payload);
+}
+
+LAUNCHER_TEST(binaryDiffAppliesWithoutBufferingTheResult)
+{
+	const auto base = makeRandom(payloadSize, 3);
+	auto target = base;
+	for (size_t pos = 0; pos < target.size(); pos += 1024 * 1024) {
+		target[pos] ^= gsl::byte(0xFF);
+	}
+	const auto diff = BinaryDiff::make(base.byte_span(), target.byte_span());
+
+	// Applied as it would be from a patch: the diff in blocks, the result compared as it's produced rather than collected
+	size_t written = 0;
+	bool matches = true;
+	AllocationTracker tracker(payloadSize / 4);
+	BinaryDiff applier(base.byte_span(), [&] (gsl::span<const gsl::byte> data) -> bool
+	{
+		matches = matches && written + data.size() <= target.size() && memcmp(target.data() + written, data.data(), data.size()) == 0;
+		written += data.size();
+		return true;
+	});
+	for (size_t pos = 0; pos < diff.size(); pos += 64 * 1024) {
+		CHECK(applier.feed(diff.byte_span().subspan(pos, std::min<size_t>(64 * 1024, diff.size() - pos))));
+	}
+	CHECK(applier.finish());
+	CHECK(matches && written == target.size());
+	CHECK(tracker.getNumLargeAllocations() == 0);
+}
@@ -0,0 +1,118 @@
+#include "test_runner.h"
+
+#include "binary_diff.h"
+
+namespace {
+	// Applies in pieces of the given size, to exercise every point where the diff can be split
+	std::optional<Bytes> apply(const Bytes& base, const Bytes& diff, size_t pieceSize)
+	{
+		Bytes result;
+		BinaryDiff applier(base.byte_span(), [&] (gsl::span<const gsl::byte> data) -> bool
+		{
+			result.insert(result.end(), data.begin(), data.end());
+			return true;
+		});
+
+		for (size_t pos = 0; pos < diff.size(); pos += pieceSize) {
+			if (!applier.feed(diff.byte_span().subspan(pos, std::min(pieceSize, diff.size() - pos)))) {
+				return std::nullopt;
+			}
+		}
+		if (!applier.finish()) {
+			return std::nullopt;
+		}
+		return result;
+	}
+
+	size_t checkRoundTrip(const Bytes& base, const Bytes& target)
+	{
+		const auto diff = BinaryDiff::make(base.byte_span(), target.byte_span());
+		for (const size_t pieceSize: { size_t(1), size_t(7), size_t(4096), std::max(diff.size(), size_t(1)) }) {
+			CHECK(apply(base, diff, pieceSize) == target);
+		}
+		return diff.size();
+	}
+
+	Bytes makeRandom(size_t size, uint32_t seed)
+	{
+		Bytes result(size);
+		for (auto& b: result) {
+			seed = seed * 1664525u + 1013904223u;
+			b = static_cast<gsl::byte>(seed >> 24);
+		}
+		return result;
+	}
+
+	Bytes toBytes(const char* text)
+	{
+		return Bytes(reinterpret_cast<const gsl::byte*>(text), reinterpret_cast<const gsl::byte*>(text) + strlen(text));
+	}
+
+	Bytes concat(std::initializer_list<Bytes> parts)
+	{
+		Bytes result;
+		for (const auto& part: parts) {
+			result.insert(result.end(), part.begin(), part.end());
+		}
+		return result;
+	}
+}
+
+LAUNCHER_TEST(binaryDiffRoundTrips)
+{
+	const auto sample = TestRunner::readData("sample.txt");
+	const auto mid = sample.begin() + static_cast<ptrdiff_t>(sample.size() / 2);
+	const auto head = Bytes(sample.begin(), mid);
+	const auto tail = Bytes(mid, sample.end());
+
+	// Unchanged, edited in the middle, with a byte removed, reordered, and grown at both ends
+	CHECK(checkRoundTrip(sample, sample) < 64);
+	CHECK(checkRoundTrip(sample, concat({ head, toBytes("an edit"), tail })) < 128);
+	CHECK(checkRoundTrip(sample, concat({ head, Bytes(tail.begin() + 1, tail.end()) })) < 128);
+	CHECK(checkRoundTrip(sample, concat({ tail, head })) < 128);
+	CHECK(checkRoundTrip(sample, concat({ toBytes("header"), sample, toBytes("footer") })) < 128);
+
+	// Binary data which shares nothing with the base is stored as it is
+	const auto random = makeRandom(100000, 1);
+	CHECK(checkRoundTrip(sample, random) < random.size() + 64);
+	CHECK(checkRoundTrip(random, concat({ random, makeRandom(1000, 2), random })) < 2000);
+}
+
+LAUNCHER_TEST(binaryDiffHandlesEmptyFiles)
+{
+	const auto sample = TestRunner::readData("sample.txt");
+	checkRoundTrip(Bytes(), sample);
+	checkRoundTrip(sample, Bytes());
+	checkRoundTrip(Bytes(), Bytes());
+	checkRoundTrip(toBytes("short"), toBytes("also short"));
+}
+
+LAUNCHER_TEST(binaryDiffRejectsCopyOutsideBase)
+{
+	const auto sample = TestRunner::readData("sample.txt");
+	const auto diff = BinaryDiff::make(sample.byte_span(), sample.byte_span());
+	CHECK(apply(sample, diff, diff.size()) == sample);
+	CHECK(!apply(Bytes(sample.begin(), sample.begin() + 100), diff, diff.size()));
+}
+
+LAUNCHER_TEST(binaryDiffRejectsTruncatedDiff)
+{
+	const auto sample = TestRunner::readData("sample.txt");
+	const auto target = concat({ toBytes("header"), sample });
+	auto diff = BinaryDiff::make(sample.byte_span(), target.byte_span());
+	for (const size_t cut: { size_t(1), size_t(8), diff.size() - 5 }) {
+		CHECK(!apply(sample, Bytes(diff.begin(), diff.end() - static_cast<ptrdiff_t>(cut)), 4096));
+	}
+}
+
+LAUNCHER_TEST(binaryDiffRejectsWrongResultSize)
+{
+	const auto sample = TestRunner::readData("sample.txt");
+	auto diff = BinaryDiff::make(sample.byte_span(), sample.byte_span());
+
+	// The result size is the u64 after the magic number
+	diff[4] = static_cast<gsl::byte>(static_cast<uint8_t>(diff[4]) + 1);
+	CHECK(!apply(sample, diff, diff.size()));
+	diff[4] = static_cast<gsl::byte>(static_cast<uint8_t>(diff[4]) - 2);
+	CHECK(!apply(sample, diff, diff.size()));
+}
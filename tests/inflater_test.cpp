@@ -0,0 +1,159 @@
+#include "test_runner.h"
+
+#include "gzip_decoder.h"
+#include "inflater.h"
+
+namespace {
+	// Decodes in pieces of the given size, to exercise every point where the decoder can run out of input
+	std::optional<Bytes> inflate(const Bytes& data, size_t pieceSize)
+	{
+		Bytes result;
+		Inflater inflater([&] (gsl::span<const gsl::byte> block) -> bool
+		{
+			result.insert(result.end(), block.begin(), block.end());
+			return true;
+		});
+
+		for (size_t pos = 0; pos < data.size(); pos += pieceSize) {
+			if (!inflater.feed(data.byte_span().subspan(pos, std::min(pieceSize, data.size() - pos)))) {
+				return std::nullopt;
+			}
+		}
+		if (!inflater.isDone() || inflater.getTotalOut() != result.size()) {
+			return std::nullopt;
+		}
+		return result;
+	}
+
+	void checkInflates(const String& name)
+	{
+		const auto data = TestRunner::readData(name);
+		const auto expected = TestRunner::readData("sample.txt");
+		CHECK(!data.empty());
+		for (const size_t pieceSize: { size_t(1), size_t(13), size_t(4096), data.size() }) {
+			CHECK(inflate(data, pieceSize) == expected);
+		}
+	}
+
+	std::optional<Bytes> gunzip(const Bytes& data, size_t pieceSize, bool allowPlain)
+	{
+		Bytes result;
+		GZipDecoder decoder([&] (gsl::span<const gsl::byte> block) -> bool
+		{
+			result.insert(result.end(), block.begin(), block.end());
+			return true;
+		}, allowPlain);
+
+		for (size_t pos = 0; pos < data.size(); pos += pieceSize) {
+			if (!decoder.feed(data.byte_span().subspan(pos, std::min(pieceSize, data.size() - pos)))) {
+				return std::nullopt;
+			}
+		}
+		if (!decoder.finish()) {
+			return std::nullopt;
+		}
+		return result;
+	}
+
+	Bytes makeBytes(std::initializer_list<uint8_t> values)
+	{
+		Bytes result;
+		for (const auto value: values) {
+			result.push_back(static_cast<gsl::byte>(value));
+		}
+		return result;
+	}
+}
+
+LAUNCHER_TEST(inflateStoredBlocks)
+{
+	checkInflates("sample_stored.deflate");
+}
+
+LAUNCHER_TEST(inflateFixedBlocks)
+{
+	checkInflates("sample_fixed.deflate");
+}
+
+LAUNCHER_TEST(inflateDynamicBlocks)
+{
+	checkInflates("sample_dynamic.deflate");
+}
+
+LAUNCHER_TEST(inflateRejectsTruncatedStream)
+{
+	auto data = TestRunner::readData("sample_dynamic.deflate");
+	data.resize(data.size() / 2);
+	CHECK(!inflate(data, data.size()));
+}
+
+LAUNCHER_TEST(inflateRejectsInvalidBlockType)
+{
+	// Final block, type 3
+	CHECK(!inflate(makeBytes({ 0x07, 0x00 }), 2));
+}
+
+LAUNCHER_TEST(inflateRejectsStoredLengthMismatch)
+{
+	// Final stored block, LEN = 1, NLEN not its complement
+	CHECK(!inflate(makeBytes({ 0x01, 0x01, 0x00, 0x00, 0x00, 0x41 }), 6));
+}
+
+LAUNCHER_TEST(inflateStopsWhenOutputAborts)
+{
+	const auto data = TestRunner::readData("sample_dynamic.deflate");
+	Inflater inflater([] (gsl::span<const gsl::byte> block) -> bool
+	{
+		return false;
+	});
+	CHECK(!inflater.feed(data.byte_span()));
+	CHECK(!inflater.isDone());
+}
+
+LAUNCHER_TEST(gzipDecodes)
+{
+	const auto expected = TestRunner::readData("sample.txt");
+	CHECK(GZipDecoder::decodeIfCompressed(TestRunner::readData("sample.gz")) == expected);
+}
+
+LAUNCHER_TEST(gzipDecodesInPieces)
+{
+	const auto data = TestRunner::readData("sample.gz");
+	const auto expected = TestRunner::readData("sample.txt");
+	for (const size_t pieceSize: { size_t(1), size_t(7), size_t(4096), data.size() }) {
+		CHECK(gunzip(data, pieceSize, false) == expected);
+		CHECK(gunzip(data, pieceSize, true) == expected);
+	}
+}
+
+LAUNCHER_TEST(gzipStreamsPlainDataOnlyWhenAllowed)
+{
+	const auto expected = TestRunner::readData("sample.txt");
+	for (const size_t pieceSize: { size_t(1), size_t(4096), expected.size() }) {
+		CHECK(gunzip(expected, pieceSize, true) == expected);
+		CHECK(!gunzip(expected, pieceSize, false));
+	}
+	CHECK(gunzip(makeBytes({ 0x7B, 0x7D }), 2, true) == makeBytes({ 0x7B, 0x7D }));
+	CHECK(gunzip(Bytes(), 1, true) == Bytes());
+}
+
+LAUNCHER_TEST(gzipRejectsTruncatedStream)
+{
+	auto data = TestRunner::readData("sample.gz");
+	data.resize(data.size() - 4);
+	CHECK(!gunzip(data, 4096, true));
+}
+
+LAUNCHER_TEST(gzipPassesThroughPlainData)
+{
+	const auto expected = TestRunner::readData("sample.txt");
+	CHECK(GZipDecoder::decodeIfCompressed(expected) == expected);
+}
+
+LAUNCHER_TEST(gzipRejectsBadChecksum)
+{
+	// The CRC-32 is the first field of the trailer
+	auto data = TestRunner::readData("sample.gz");
+	data[data.size() - 8] ^= gsl::byte(0xFF);
+	CHECK(!GZipDecoder::decodeIfCompressed(std::move(data)));
+}
@@ -0,0 +1,61 @@
+#include "test_runner.h"
+
+#include "project_data_parser.h"
+
+namespace {
+	Bytes toBytes(const std::string& str)
+	{
+		Bytes result(str.size());
+		memcpy(result.data(), str.data(), str.size());
+		return result;
+	}
+
+	bool parseInPieces(const Path& dst, const Bytes& data, size_t pieceSize)
+	{
+		ProjectDataParser parser(dst);
+		for (size_t pos = 0; pos < data.size(); pos += pieceSize) {
+			if (!parser.feed(data.byte_span().subspan(pos, std::min(pieceSize, data.size() - pos)))) {
+				return false;
+			}
+		}
+		return parser.finish();
+	}
+}
+
+LAUNCHER_TEST(projectDataWritesFiles)
+{
+	// "bytes" can come before "path", and anything outside the file entries is skipped
+	const auto data = toBytes(R"({ "version": 2, "files": [
+		{ "path": "halley_project/properties.yaml", "bytes": "aGVsbG8gd29ybGQ=" },
+		{ "bytes": "Zm9v", "path": "src/foo.txt", "size": 3 },
+		{ "path": "a.txt", "bytes": "YmFy" }
+	], "extra": [ 1, true, null, "x\"y", { "files": [] } ] })");
+
+	for (const size_t pieceSize: { size_t(1), size_t(7), data.size() }) {
+		const auto dst = TestRunner::makeTempDir("project_data");
+		CHECK(parseInPieces(dst, data, pieceSize));
+		CHECK(Path::readFile(dst / "halley_project" / "properties.yaml") == toBytes("hello world"));
+		CHECK(Path::readFile(dst / "src" / "foo.txt") == toBytes("foo"));
+		CHECK(Path::readFile(dst / "a.txt") == toBytes("bar"));
+	}
+}
+
+LAUNCHER_TEST(projectDataSkipsUnsafePaths)
+{
+	const auto data = toBytes(R"({ "files": [ { "path": "../escaped.txt", "bytes": "Zm9v" }, { "path": "ok.txt", "bytes": "Zm9v" } ] })");
+	const auto dst = TestRunner::makeTempDir("project_data_unsafe") / "project";
+
+	ProjectDataParser parser(dst);
+	CHECK(parser.feed(data.byte_span()));
+	CHECK(parser.finish());
+	CHECK(parser.getNumFilesWritten() == 1);
+	CHECK(!Path::exists(dst / ".." / "escaped.txt"));
+}
+
+LAUNCHER_TEST(projectDataRejectsMalformedJSON)
+{
+	const auto dst = TestRunner::makeTempDir("project_data_malformed");
+	CHECK(!parseInPieces(dst, toBytes(R"({ "files": [ { "path": "a.txt", "bytes": "Zm9v" })"), 1));
+	CHECK(!parseInPieces(dst, toBytes(R"({ "files": [ { "path" "a.txt" } ] })"), 1));
+	CHECK(!parseInPieces(dst, toBytes(R"({ "files": [] } })"), 1));
+}
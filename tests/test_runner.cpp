@@ -0,0 +1,118 @@
+#include "test_runner.h"
+
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+
+#include "inflater.h"
+
+namespace {
+	struct Test {
+		const char* name;
+		TestRunner::TestFunction function;
+	};
+
+	Vector<Test>& getTests()
+	{
+		static Vector<Test> tests;
+		return tests;
+	}
+
+	Path dataPath;
+	Vector<Path> tempDirs;
+	int numFailures = 0;
+
+	int runBenchmark(const Path& path)
+	{
+		// Raw deflate throughput, fed in the same block size ZipReader uses
+		const auto data = Path::readFile(path);
+		constexpr size_t blockSize = 64 * 1024;
+		constexpr int repeats = 10;
+
+		uint64_t outSize = 0;
+		const auto start = std::chrono::steady_clock::now();
+		for (int i = 0; i < repeats; ++i) {
+			outSize = 0;
+			Inflater inflater([&] (gsl::span<const gsl::byte> block) -> bool
+			{
+				outSize += block.size();
+				return true;
+			});
+			for (size_t pos = 0; pos < data.size(); pos += blockSize) {
+				inflater.feed(data.byte_span().subspan(pos, std::min(blockSize, data.size() - pos)));
+			}
+			if (!inflater.isDone()) {
+				std::cerr << "Not a complete deflate stream: " << path.getNativeString(false) << std::endl;
+				return 1;
+			}
+		}
+		const auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / repeats;
+		std::cout << "Inflated " << outSize << " bytes at " << static_cast<int>(double(outSize) / seconds / 1e6) << " MB/s" << std::endl;
+		return 0;
+	}
+}
+
+TestRunner::Registration::Registration(const char* name, TestFunction function)
+{
+	getTests().push_back(Test{ name, function });
+}
+
+void TestRunner::fail(const char* file, int line, const char* expression)
+{
+	std::cerr << "  " << file << "(" << line << "): CHECK(" << expression << ") failed" << std::endl;
+	++numFailures;
+}
+
+const Path& TestRunner::getDataPath()
+{
+	return dataPath;
+}
+
+Bytes TestRunner::readData(const String& name)
+{
+	return Path::readFile(dataPath / name);
+}
+
+Path TestRunner::makeTempDir(const String& name)
+{
+	const auto path = Path(std::filesystem::temp_directory_path().string()) / "halley-launcher-tests" / name;
+	std::error_code ec;
+	std::filesystem::remove_all(path.getString().cppStr(), ec);
+	std::filesystem::create_directories(path.getString().cppStr(), ec);
+	tempDirs.push_back(path);
+	return path;
+}
+
+// Usage: halley-launcher-tests <data path> [--benchmark <raw deflate file>]
+int main(int argc, char** argv)
+{
+	if (argc < 2) {
+		std::cerr << "Usage: " << argv[0] << " <data path> [--benchmark <raw deflate file>]" << std::endl;
+		return 1;
+	}
+	dataPath = Path(argv[1]);
+	if (argc >= 4 && String(argv[2]) == "--benchmark") {
+		return runBenchmark(Path(argv[3]));
+	}
+
+	int numFailedTests = 0;
+	for (const auto& test: getTests()) {
+		const auto failuresBefore = numFailures;
+		test.function();
+
+		std::error_code ec;
+		for (const auto& dir: tempDirs) {
+			std::filesystem::remove_all(dir.getString().cppStr(), ec);
+		}
+		tempDirs.clear();
+
+		const bool passed = numFailures == failuresBefore;
+		std::cout << (passed ? "[  OK  ] " : "[FAILED] ") << test.name << std::endl;
+		if (!passed) {
+			++numFailedTests;
+		}
+	}
+
+	std::cout << getTests().size() - numFailedTests << "/" << getTests().size() << " tests passed" << std::endl;
+	return numFailedTests == 0 ? 0 : 1;
+}
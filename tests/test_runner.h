@@ -0,0 +1,35 @@
+#pragma once
+
+#include <halley.hpp>
+using namespace Halley;
+
+// Minimal test runner, so the launcher's tests don't need anything beyond the engine.
+// Tests register themselves with LAUNCHER_TEST, and report failures with CHECK.
+namespace TestRunner {
+	using TestFunction = void(*)();
+
+	struct Registration {
+		Registration(const char* name, TestFunction function);
+	};
+
+	void fail(const char* file, int line, const char* expression);
+
+	// Folder holding the test fixtures, passed on the command line
+	const Path& getDataPath();
+	Bytes readData(const String& name);
+
+	// Empty folder for a test to write to, removed again when the test finishes
+	Path makeTempDir(const String& name);
+}
+
+#define LAUNCHER_TEST(name) \
+	static void name(); \
+	static TestRunner::Registration name##Registration(#name, &name); \
+	static void name()
+
+#define CHECK(expression) \
+	do { \
+		if (!(expression)) { \
+			TestRunner::fail(__FILE__, __LINE__, #expression); \
+		} \
+	} while (false)
@@ -0,0 +1,214 @@
+#include "test_runner.h"
+
+#include <filesystem>
+
+#include "zip_extractor.h"
+#include "zip_reader.h"
+#include "zip_stream_extractor.h"
+
+namespace {
+	const ZipReader::Entry* findEntry(const ZipReader& reader, const String& name)
+	{
+		for (const auto& entry: reader.getEntries()) {
+			if (entry.name == name) {
+				return &entry;
+			}
+		}
+		return nullptr;
+	}
+
+	void checkReads(const String& archive, const String& name, const Bytes& expected)
+	{
+		ZipReader reader;
+		CHECK(reader.open(TestRunner::getDataPath() / archive));
+
+		const auto* entry = findEntry(reader, name);
+		CHECK(entry != nullptr);
+		if (entry) {
+			CHECK(reader.extractBytes(*entry) == expected);
+		}
+	}
+
+	void checkStreamExtracts(const String& archive, const Vector<std::pair<String, Bytes>>& expected)
+	{
+		const auto data = TestRunner::readData(archive);
+		for (const size_t pieceSize: { size_t(1), size_t(100), size_t(16 * 1024), data.size() }) {
+			const auto dst = TestRunner::makeTempDir("stream");
+			ZipStreamExtractor extractor(dst);
+			for (size_t pos = 0; pos < data.size(); pos += pieceSize) {
+				CHECK(extractor.feed(data.byte_span().subspan(pos, std::min(pieceSize, data.size() - pos))));
+			}
+			CHECK(extractor.isDone());
+			for (const auto& [name, bytes]: expected) {
+				CHECK(Path::readFile(dst / name) == bytes);
+			}
+		}
+	}
+
+	Bytes getSmall()
+	{
+		const String text = "A stored entry.\n";
+		return Bytes(reinterpret_cast<const gsl::byte*>(text.c_str()), reinterpret_cast<const gsl::byte*>(text.c_str()) + text.size());
+	}
+}
+
+LAUNCHER_TEST(zipReadsDeflatedAndStoredEntries)
+{
+	const auto sample = TestRunner::readData("sample.txt");
+	checkReads("deflate.zip", "bin/sample.txt", sample);
+	checkReads("deflate.zip", "small.txt", getSmall());
+
+	ZipReader reader;
+	CHECK(reader.open(TestRunner::getDataPath() / "deflate.zip"));
+	const auto* dir = findEntry(reader, "bin/");
+	CHECK(dir && dir->isDirectory());
+}
+
+LAUNCHER_TEST(zipReadsEntriesWithDataDescriptors)
+{
+	const auto sample = TestRunner::readData("sample.txt");
+	checkReads("descriptor.zip", "bin/sample.txt", sample);
+	checkReads("descriptor.zip", "other.txt", Bytes(sample.begin(), sample.begin() + 5000));
+}
+
+LAUNCHER_TEST(zipReadsZip64)
+{
+	checkReads("zip64.zip", "bin/sample.txt", TestRunner::readData("sample.txt"));
+	checkReads("zip64.zip", "small.txt", getSmall());
+}
+
+LAUNCHER_TEST(zipRejectsCorruptEntry)
+{
+	// Flip a byte inside the stored entry's data, which the CRC check has to catch
+	auto data = TestRunner::readData("deflate.zip");
+	const auto small = getSmall();
+	const auto iter = std::search(data.begin(), data.end(), small.begin(), small.end());
+	CHECK(iter != data.end());
+	if (iter == data.end()) {
+		return;
+	}
+	*iter ^= gsl::byte(0x20);
+
+	const auto path = TestRunner::makeTempDir("corrupt") / "corrupt.zip";
+	CHECK(Path::writeFile(path, data));
+
+	ZipReader reader;
+	CHECK(reader.open(path));
+	const auto* entry = findEntry(reader, "small.txt");
+	CHECK(entry && !reader.extractBytes(*entry));
+}
+
+LAUNCHER_TEST(zipRejectsTruncatedArchive)
+{
+	auto data = TestRunner::readData("deflate.zip");
+	data.resize(data.size() - 10);
+	const auto path = TestRunner::makeTempDir("truncated") / "truncated.zip";
+	CHECK(Path::writeFile(path, data));
+
+	ZipReader reader;
+	CHECK(!reader.open(path));
+}
+
+LAUNCHER_TEST(zipRejectsWrappingDirectoryBounds)
+{
+	// Point the zip64 central directory so far out that its offset plus its size wraps around to inside the file
+	auto data = TestRunner::readData("zip64.zip");
+	auto findRecord = [&] (uint8_t a, uint8_t b) -> std::optional<size_t>
+	{
+		const auto signature = std::array<gsl::byte, 4>{ gsl::byte(0x50), gsl::byte(0x4B), gsl::byte(a), gsl::byte(b) };
+		const auto iter = std::search(data.begin(), data.end(), signature.begin(), signature.end());
+		return iter == data.end() ? std::nullopt : std::optional<size_t>(iter - data.begin());
+	};
+	const auto record = findRecord(0x06, 0x06);
+	const auto end = findRecord(0x05, 0x06);
+	CHECK(record && end);
+	if (!record || !end) {
+		return;
+	}
+	for (size_t i = 0; i < 8; ++i) {
+		data[*record + 40 + i] = gsl::byte(i == 1 ? 0x02 : 0x00);
+		data[*record + 48 + i] = gsl::byte(i == 0 ? 0x00 : 0xFF);
+	}
+	for (size_t i = 0; i < 4; ++i) {
+		data[*end + 16 + i] = gsl::byte(0xFF);
+	}
+
+	const auto path = TestRunner::makeTempDir("wrapping") / "wrapping.zip";
+	CHECK(Path::writeFile(path, data));
+
+	ZipReader reader;
+	CHECK(!reader.open(path));
+}
+
+LAUNCHER_TEST(zipStreamExtracts)
+{
+	const auto sample = TestRunner::readData("sample.txt");
+	checkStreamExtracts("deflate.zip", { { "bin/sample.txt", sample }, { "small.txt", getSmall() } });
+	checkStreamExtracts("zip64.zip", { { "bin/sample.txt", sample }, { "small.txt", getSmall() } });
+	checkStreamExtracts("descriptor.zip", { { "bin/sample.txt", sample }, { "other.txt", Bytes(sample.begin(), sample.begin() + 5000) } });
+}
+
+LAUNCHER_TEST(zipStreamRejectsUnsafePaths)
+{
+	const auto root = TestRunner::makeTempDir("unsafe");
+	const auto dst = root / "dst";
+	ZipStreamExtractor extractor(dst);
+	CHECK(!extractor.feed(TestRunner::readData("unsafe.zip").byte_span()));
+	CHECK(!Path::exists(root / "evil.txt"));
+}
+
+LAUNCHER_TEST(zipExtractorExtracts)
+{
+	const auto sample = TestRunner::readData("sample.txt");
+	for (const auto& archive: { "deflate.zip", "zip64.zip" }) {
+		for (const int threads: { 1, 4 }) {
+			const auto dst = TestRunner::makeTempDir("extract");
+			ZipExtractor extractor(TestRunner::getDataPath() / archive, dst);
+			extractor.setMaxThreads(threads);
+			CHECK(extractor.extract());
+			CHECK(Path::readFile(dst / "bin" / "sample.txt") == sample);
+			CHECK(Path::readFile(dst / "small.txt") == getSmall());
+		}
+	}
+}
+
+LAUNCHER_TEST(zipExtractorSkipsUnchangedFiles)
+{
+	const auto root = TestRunner::makeTempDir("differential");
+	const auto dst = root / "dst";
+	for (const size_t expectedSkipped: { size_t(0), size_t(2) }) {
+		ZipExtractor extractor(TestRunner::getDataPath() / "deflate.zip", dst);
+		extractor.setDifferential(root / "index");
+		CHECK(extractor.extract());
+		CHECK(extractor.getNumFilesSkipped() == expectedSkipped);
+	}
+
+	// The index is kept where it was asked to be, not in the destination
+	size_t numFiles = 0;
+	for (const auto& file: std::filesystem::directory_iterator(dst.getString().cppStr())) {
+		CHECK(file.path().filename() == "bin" || file.path().filename() == "small.txt");
+		++numFiles;
+	}
+	CHECK(numFiles == 2);
+}
+
+LAUNCHER_TEST(zipExtractorRejectsUnsafePaths)
+{
+	const auto root = TestRunner::makeTempDir("unsafe");
+	ZipExtractor extractor(TestRunner::getDataPath() / "unsafe.zip", root / "dst");
+	CHECK(!extractor.extract());
+	CHECK(extractor.getFailedEntry() == "../evil.txt");
+	CHECK(!Path::exists(root / "evil.txt"));
+}
+
+LAUNCHER_TEST(zipSafeNames)
+{
+	CHECK(ZipReader::isSafeName("bin/editor.exe"));
+	CHECK(ZipReader::isSafeName("bin/..data"));
+	CHECK(!ZipReader::isSafeName(""));
+	CHECK(!ZipReader::isSafeName("/etc/passwd"));
+	CHECK(!ZipReader::isSafeName("\\Windows\\evil.dll"));
+	CHECK(!ZipReader::isSafeName("C:/evil.dll"));
+	CHECK(!ZipReader::isSafeName("bin/../../evil.txt"));
+	CHECK(!ZipReader::isSafeName("bin\\..\\..\\evil.txt"));
+}